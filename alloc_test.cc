@@ -0,0 +1,94 @@
+// Counts the heap allocations of setting up a flag set and parsing with a
+// memory resource over a fixed buffer.  Exits with 1 if there are more than
+// expected.
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "flag.hh"
+
+static long allocations = 0;
+
+void *
+operator new (std::size_t size)
+{
+  ++allocations;
+  if (void *p = std::malloc (size ? size : 1))
+    return p;
+  throw std::bad_alloc ();
+}
+
+void
+operator delete (void *p) noexcept
+{
+  std::free (p);
+}
+
+void
+operator delete (void *p, std::size_t) noexcept
+{
+  std::free (p);
+}
+
+struct Custom
+{
+  int value;
+};
+
+namespace flag { namespace types {
+
+template <>
+struct Value_Type<Custom>
+{
+  static constexpr bool is_supported = true;
+  static constexpr const char *value_name = "custom";
+
+  static void convert_arg (std::string_view arg, Custom *value)
+  { value->value = static_cast<int> (arg.size ()); }
+};
+
+}}
+
+static bool
+check (const char *what, long count, long expected)
+{
+  std::printf ("%s: %ld heap allocations (expected %ld)\n", what, count,
+               expected);
+  return count == expected;
+}
+
+int
+main ()
+{
+  alignas (std::max_align_t) static char buffer[1 << 16];
+  std::pmr::monotonic_buffer_resource arena (buffer, sizeof buffer,
+                                             std::pmr::null_memory_resource ());
+  int n = 0;
+  bool verbose = false;
+  Custom custom = {};
+  std::string name;
+  bool ok = true;
+
+  long before = allocations;
+  flag::Flag_Set set (&arena);
+  set.add (n, "n", "a number");
+  set.add (verbose, "v", "verbose");
+  set.add (custom, "custom", "a custom type");
+  set.add (name, "some-longer-flag-name-for-sso", "a string");
+  set.add ([] (std::string_view) { return true; }, "callback");
+  set.alias ("n", "num");
+  set.allow_abbreviations ();
+  set.freeze ();
+  ok &= check ("registering and freezing", allocations - before, 0);
+
+  const char *argv[] = {"program", "-n", "3", "x", "-v", "-custom", "q", "y",
+                        "-callback=z", "-some-longer-flag-name-for-sso",
+                        "a string value longer than the small buffer", "z"};
+  const int argc = static_cast<int> (std::size (argv));
+  before = allocations;
+  const auto args = set.parse (argc, argv, &arena);
+  // The value assigned to the `std::string`.
+  ok &= check ("parsing into a pmr vector", allocations - before, 1);
+  ok &= args.size () == 3 && n == 3 && verbose && custom.value == 1;
+  return ok ? 0 : 1;
+}
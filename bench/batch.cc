@@ -0,0 +1,53 @@
+// Parses a million command lines into a schema with `flag::parse_batch`,
+// reporting the throughput for growing thread counts up to the hardware
+// concurrency or the count given as argument.
+#include <cstdlib>
+#include <thread>
+#include "bench.hh"
+
+using Sink = flag::Batch_Sink<flag::Opt<"threads", int>, flag::Opt<"v", bool>,
+                              flag::Opt<"name", std::string_view>,
+                              flag::Opt<"scale", double>>;
+
+int
+main (int argc, char **argv)
+{
+  constexpr std::size_t LINES = 1000000;
+  std::vector<bench::Args> args;
+  args.reserve (LINES);
+  std::vector<flag::Command_Line> command_lines;
+  for (std::size_t i = 0; i < LINES; ++i)
+    {
+      std::vector<std::string> line = {
+        "tool", "-threads", std::to_string (i % 64), "-v",
+        "--name=job" + std::to_string (i), "in" + std::to_string (i),
+        "-scale", "1.5"};
+      // Some invalid lines, reported through the results.
+      if (i % 1000 == 0)
+        line.push_back ("-bogus");
+      args.emplace_back (std::move (line));
+      command_lines.push_back ({args.back ().argc (),
+                                args.back ().argv.data ()});
+    }
+  flag::Flag_Set set;
+  bool quiet = false;
+  set.add (quiet, "q");
+
+  const unsigned max_threads
+    = (argc > 1 ? static_cast<unsigned> (std::atoi (argv[1]))
+                : std::thread::hardware_concurrency ());
+  for (unsigned threads = 1; threads <= std::max (max_threads, 1u);
+       threads *= 2)
+    {
+      std::vector<Sink> sinks (LINES);
+      std::vector<flag::Process_Result> results (LINES);
+      const double seconds = bench::seconds_per_run (1, [&] {
+        flag::parse_batch<Sink> (set, command_lines, sinks, results, threads);
+      });
+      std::size_t failed = 0;
+      for (const flag::Process_Result result : results)
+        failed += result != flag::Process_Result::Ok;
+      std::printf ("%u threads: %.2f M command lines/s (%zu failed)\n",
+                   threads, LINES / seconds / 1e6, failed);
+    }
+}
@@ -0,0 +1,50 @@
+// Helpers shared by the benchmarks, see "Benchmarks" in README.md.
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "../flag.hh"
+
+namespace bench
+{
+/// Returns the seconds per run of `f`, which is run `runs` times after one
+/// warm-up run.
+template <class F>
+static double
+seconds_per_run (int runs, F &&f)
+{
+  f ();
+  const auto start = std::chrono::steady_clock::now ();
+  for (int i = 0; i < runs; ++i)
+    f ();
+  const std::chrono::duration<double> elapsed
+    = std::chrono::steady_clock::now () - start;
+  return elapsed.count () / runs;
+}
+
+/// Keeps the compiler from optimizing away the computation of `value`.
+template <class T>
+static void
+keep (const T &value)
+{
+  asm volatile ("" : : "g" (&value) : "memory");
+}
+
+/// Owns the strings of an argument vector built by a benchmark.
+struct Args
+{
+  std::vector<std::string> strings;
+  std::vector<const char *> argv;
+
+  explicit Args (std::vector<std::string> args)
+  : strings (std::move (args))
+  {
+    for (const std::string &arg : strings)
+      argv.push_back (arg.c_str ());
+    argv.push_back (nullptr);
+  }
+
+  int argc () const
+  { return static_cast<int> (strings.size ()); }
+};
+}
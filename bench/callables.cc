@@ -0,0 +1,47 @@
+// Parses a command line with callback flags and a collector given as
+// lambdas, which are stored inline and called directly, compared to the same
+// callables wrapped in `std::function`.
+#include "bench.hh"
+
+int
+main ()
+{
+  const bench::Args command_line ({"program", "-a", "x1", "f1", "f2", "-b=y2",
+                                   "f3", "f4", "-n", "3", "f5", "f6", "f7",
+                                   "f8", "f9", "f10"});
+  long sum = 0;
+  int n = 0;
+  const auto a = [&sum] (std::string_view value) {
+    sum += value[0];
+    return true;
+  };
+  const auto b = [&sum] (std::string_view value) {
+    sum += value[1];
+    return true;
+  };
+  const auto collect = [&sum] (const char *arg) { sum += arg[1]; };
+
+  flag::Flag_Set inline_set;
+  inline_set.add (a, "a");
+  inline_set.add (b, "b");
+  inline_set.add (n, "n");
+  flag::Flag_Set function_set;
+  function_set.add (flag::Option_Callable (a), "a");
+  function_set.add (flag::Option_Callable (b), "b");
+  function_set.add (n, "n");
+  const flag::Collect_Arg collect_function = collect;
+
+  constexpr int RUNS = 1000000;
+  const double lambdas = bench::seconds_per_run (RUNS, [&] {
+    inline_set.parse (command_line.argc (), command_line.argv.data (),
+                      collect);
+  });
+  const double functions = bench::seconds_per_run (RUNS, [&] {
+    function_set.parse (command_line.argc (), command_line.argv.data (),
+                        collect_function);
+  });
+  bench::keep (sum);
+  std::printf ("%d arguments: %.1f ns per parse with lambdas, %.1f ns with "
+               "std::function\n", command_line.argc (), lambdas * 1e9,
+               functions * 1e9);
+}
@@ -0,0 +1,78 @@
+// Parses 20k `/proc/PID/cmdline`-like buffers of null-separated arguments
+// in place with `flag::parse_batch`, compared to first building an argument
+// vector for each of them.
+#include <cstring>
+#include <random>
+#include "bench.hh"
+
+using Sink = flag::Batch_Sink<flag::Opt<"threads", int>, flag::Opt<"v", bool>,
+                              flag::Opt<"name", std::string_view>,
+                              flag::Opt<"scale", double>,
+                              flag::Opt<"config", std::string_view>>;
+
+int
+main ()
+{
+  constexpr std::size_t LINES = 20000;
+  const char *const words[] = {"-threads", "8", "-v", "-name", "worker",
+                               "-scale=0.75", "-config",
+                               "/etc/agent/conf.d/a.yaml", "--", "input.dat",
+                               "/var/lib/x/y", "-unknown"};
+  std::mt19937 random (1);
+  std::vector<std::string> buffers (LINES);
+  for (std::string &buffer : buffers)
+    {
+      buffer = "/usr/bin/agent";
+      buffer.push_back ('\0');
+      for (unsigned i = 0, n = 4 + random () % 12; i < n; ++i)
+        {
+          const unsigned word = random () % (std::size (words) - 1);
+          buffer += words[word];
+          buffer.push_back ('\0');
+          if (word == 0)
+            {
+              buffer += std::to_string (random () % 64);
+              buffer.push_back ('\0');
+            }
+        }
+    }
+
+  flag::Flag_Set set;
+  std::vector<flag::Null_Separated> lines;
+  for (const std::string &buffer : buffers)
+    lines.push_back ({buffer});
+  std::vector<Sink> sinks (LINES);
+  std::vector<flag::Process_Result> results (LINES);
+  const auto clear = [&sinks] {
+    for (Sink &sink : sinks)
+      sink.args.clear ();
+  };
+
+  const double in_place = bench::seconds_per_run (10, [&] {
+    clear ();
+    flag::parse_batch<Sink> (set, lines, sinks, results, 1);
+  });
+  std::size_t ok = 0;
+  for (const flag::Process_Result result : results)
+    ok += result == flag::Process_Result::Ok;
+
+  std::vector<std::vector<const char *>> argvs (LINES);
+  std::vector<flag::Command_Line> command_lines (LINES);
+  const double argv = bench::seconds_per_run (10, [&] {
+    clear ();
+    for (std::size_t i = 0; i < LINES; ++i)
+      {
+        std::vector<const char *> &args = argvs[i];
+        args.clear ();
+        for (const char *p = buffers[i].data (),
+                        *end = p + buffers[i].size ();
+             p < end; p += std::strlen (p) + 1)
+          args.push_back (p);
+        command_lines[i] = {static_cast<int> (args.size ()), args.data ()};
+      }
+    flag::parse_batch<Sink> (set, command_lines, sinks, results, 1);
+  });
+  std::printf ("%zu command lines (%zu ok): %.1f ns each in place, %.1f ns "
+               "building argument vectors\n", LINES, ok,
+               in_place * 1e9 / LINES, argv * 1e9 / LINES);
+}
@@ -0,0 +1,72 @@
+// Converts 5M config-like floating-point values with the `Value_Type` of
+// `double`, compared to `strtod`, and checks `long double` against
+// `strtold`.
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include "bench.hh"
+
+int
+main ()
+{
+  constexpr int INPUTS = 5000000;
+  const char *const common[] = {"0.5", "1.0", "2.5", "0.001", "1e-6",
+                                "3.14159", "0.75", "100", "1.5e3", "0.9"};
+  std::mt19937_64 random (1);
+  std::vector<std::string> inputs;
+  inputs.reserve (INPUTS);
+  for (int i = 0; i < INPUTS; ++i)
+    {
+      char buffer[64];
+      switch (random () % 3)
+        {
+          case 0:
+            inputs.emplace_back (common[random () % std::size (common)]);
+            continue;
+          case 1:
+            std::snprintf (buffer, sizeof buffer, "%.*f",
+                           static_cast<int> (random () % 6),
+                           static_cast<double> (random () % 100000) / 97);
+            break;
+          default:
+            // Arbitrary doubles with all 17 significant digits.
+            std::snprintf (buffer, sizeof buffer, "%.17g",
+                           std::ldexp (static_cast<double> (random () >> 11),
+                                       -53) * 1e3);
+        }
+      inputs.emplace_back (buffer);
+    }
+
+  double sum = 0;
+  const double from_chars = bench::seconds_per_run (1, [&] {
+    for (const std::string &input : inputs)
+      {
+        double value;
+        if (flag::types::Value_Type<double>::try_convert_arg (input, &value)
+            == std::errc {})
+          sum += value;
+      }
+  });
+  const double strtod = bench::seconds_per_run (1, [&] {
+    for (const std::string &input : inputs)
+      sum += std::strtod (input.c_str (), nullptr);
+  });
+  bench::keep (sum);
+
+  int mismatches = 0;
+  for (int i = 0; i < INPUTS; i += 10)
+    {
+      const std::string &input = inputs[i];
+      double value = 0;
+      long double long_value = 0;
+      flag::types::Value_Type<double>::try_convert_arg (input, &value);
+      flag::types::Value_Type<long double>::try_convert_arg (input,
+                                                             &long_value);
+      mismatches += (value != std::strtod (input.c_str (), nullptr)
+                     || long_value != std::strtold (input.c_str (), nullptr));
+    }
+  std::printf ("%d inputs: %.1f ns per conversion, strtod %.1f ns "
+               "(%d of %d checked results differ)\n", INPUTS,
+               from_chars * 1e9 / INPUTS, strtod * 1e9 / INPUTS, mismatches,
+               INPUTS / 10);
+}
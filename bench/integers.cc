@@ -0,0 +1,55 @@
+// Converts 10M random decimal and hexadecimal integers with the
+// `Value_Type` of `long long`, compared to `strtoll`.
+#include <cstdlib>
+#include <random>
+#include "bench.hh"
+
+int
+main ()
+{
+  constexpr int INPUTS = 10000000;
+  std::mt19937_64 random (1);
+  std::vector<std::string> inputs;
+  inputs.reserve (INPUTS);
+  for (int i = 0; i < INPUTS; ++i)
+    {
+      // Magnitudes of all lengths, not only the ones close to the maximum.
+      const auto magnitude = random () >> (random () % 63 + 1);
+      const bool negative = random () & 1;
+      char buffer[32];
+      if (random () % 4 == 0)
+        std::snprintf (buffer, sizeof buffer, "%s0x%llx", negative ? "-" : "",
+                       static_cast<unsigned long long> (magnitude));
+      else
+        std::snprintf (buffer, sizeof buffer, "%s%llu", negative ? "-" : "",
+                       static_cast<unsigned long long> (magnitude));
+      inputs.emplace_back (buffer);
+    }
+
+  using Type = flag::types::Value_Type<long long>;
+  long long sum = 0;
+  const double from_chars = bench::seconds_per_run (1, [&] {
+    for (const std::string &input : inputs)
+      {
+        long long value;
+        if (Type::try_convert_arg (input, &value) == std::errc {})
+          sum += value;
+      }
+  });
+  const double strtoll = bench::seconds_per_run (1, [&] {
+    for (const std::string &input : inputs)
+      sum += std::strtoll (input.c_str (), nullptr, 0);
+  });
+  bench::keep (sum);
+
+  int mismatches = 0;
+  for (const std::string &input : inputs)
+    {
+      long long value = 0;
+      Type::try_convert_arg (input, &value);
+      mismatches += value != std::strtoll (input.c_str (), nullptr, 0);
+    }
+  std::printf ("%d inputs: %.1f ns per conversion, strtoll %.1f ns "
+               "(%d results differ)\n", INPUTS, from_chars * 1e9 / INPUTS,
+               strtoll * 1e9 / INPUTS, mismatches);
+}
@@ -0,0 +1,44 @@
+// Looks up flags in a set of 10k flags through the index built by
+// `Flag_Set::freeze`, compared to the linear scan it replaced.
+#include <algorithm>
+#include "bench.hh"
+
+int
+main ()
+{
+  constexpr int FLAGS = 10000;
+  constexpr int ARGS = 1000;
+  std::vector<std::string> names;
+  for (int i = 0; i < FLAGS; ++i)
+    names.push_back ("flag-" + std::to_string (i));
+  std::vector<int> values (FLAGS);
+  flag::Flag_Set set;
+  for (int i = 0; i < FLAGS; ++i)
+    set.add (values[i], names[i]);
+
+  std::vector<std::string> args = {"program"};
+  for (int i = 0; i < ARGS; ++i)
+    {
+      args.push_back ("-" + names[(i * 7919) % FLAGS]);
+      args.push_back ("1");
+    }
+  const bench::Args command_line (std::move (args));
+
+  const double indexed = bench::seconds_per_run (100, [&] {
+    set.parse (command_line.argc (), command_line.argv.data (),
+               [] (const char *) {});
+  });
+  const double scan = bench::seconds_per_run (10, [&] {
+    for (int i = 1; i < command_line.argc (); i += 2)
+      {
+        const std::string_view flag = command_line.argv[i] + 1;
+        bench::keep (std::find_if (names.begin (), names.end (),
+                                   [flag] (const std::string &name) {
+          return name == flag;
+        }));
+      }
+  });
+  std::printf ("%d flags, %d per command line: %.3f ms per parse, "
+               "%.3f ms for the lookups by linear scan\n",
+               FLAGS, ARGS, indexed * 1e3, scan * 1e3);
+}
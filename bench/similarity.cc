@@ -0,0 +1,103 @@
+// Compares `flag::similarity`, which searches the Jaro match window 16 bytes
+// at a time, to the scalar search it replaced, checking that both agree.
+#include <random>
+#include "bench.hh"
+
+// The scalar Jaro similarity as it was before the match window search was
+// vectorized.
+static double
+scalar_jaro (std::string_view a, std::string_view b)
+{
+  a = a.substr (0, flag::detail::MAX_SIMILARITY_LENGTH);
+  b = b.substr (0, flag::detail::MAX_SIMILARITY_LENGTH);
+  if (a.empty () && b.empty ())
+    return 1.0;
+  else if (a.empty () || b.empty ())
+    return 0.0;
+  else if (a.size () == 1 && b.size () == 1)
+    return a[0] == b[0] ? 1.0 : 0.0;
+
+  const auto match_range = std::max (a.size (), b.size ()) / 2 - 1;
+  std::array<std::uint64_t, flag::detail::MAX_SIMILARITY_LENGTH / 64> used {};
+  auto b_pos = std::size_t {};
+  auto matches = 0.0;
+  auto transpositions = 0.0;
+  for (std::size_t i = 0; i < a.size (); ++i)
+    {
+      const auto lo = i > match_range ? i - match_range : 0;
+      const auto hi = std::min (i + match_range, b.size () - 1);
+      for (std::size_t j = lo; j <= hi; ++j)
+        {
+          const auto bit = std::uint64_t {1} << (j % 64);
+          if (a[i] == b[j] && !(used[j / 64] & bit))
+            {
+              used[j / 64] |= bit;
+              ++matches;
+              if (j < b_pos)
+                ++transpositions;
+              b_pos = j;
+              break;
+            }
+        }
+    }
+  if (matches == 0.0)
+    return 0.0;
+  return 0.333 * ((matches / a.size ()) + (matches / b.size ())
+                  + ((matches - transpositions) / matches));
+}
+
+static double
+scalar_similarity (std::string_view a, std::string_view b)
+{
+  const double jaro = scalar_jaro (a, b);
+  const auto prefix = std::mismatch (a.begin (), a.end (), b.begin (),
+                                     b.end ()).first - a.begin ();
+  const double winkler = jaro - prefix * 0.1 * (1.0 - jaro);
+  return winkler <= 1.0 ? winkler : 1.0;
+}
+
+int
+main ()
+{
+  std::mt19937 random (1);
+  const auto make = [&random] (std::size_t length, unsigned alphabet) {
+    std::string str;
+    for (std::size_t i = 0; i < length; ++i)
+      str += static_cast<char> ('a' + random () % alphabet);
+    return str;
+  };
+
+  int mismatches = 0;
+  for (int i = 0; i < 200000; ++i)
+    {
+      const unsigned alphabet = 1 + random () % 6;
+      const std::string a = make (random () % 300, alphabet);
+      const std::string b = make (random () % 300, alphabet);
+      mismatches += flag::similarity (a, b) != scalar_similarity (a, b);
+    }
+  std::printf ("%d of 200000 random pairs differ\n", mismatches);
+
+  constexpr int PAIRS = 2000;
+  for (const std::size_t length : {12, 40, 200})
+    {
+      std::vector<std::string> a, b;
+      for (int i = 0; i < PAIRS; ++i)
+        {
+          a.push_back (make (length, 26));
+          b.push_back (make (length, 26));
+        }
+      const auto time = [&] (auto similarity) {
+        return bench::seconds_per_run (20, [&] {
+          double sum = 0;
+          for (int i = 0; i < PAIRS; ++i)
+            sum += similarity (a[i], b[i]);
+          bench::keep (sum);
+        }) / PAIRS;
+      };
+      const double vectorized = time (flag::similarity);
+      const double scalar = time (scalar_similarity);
+      std::printf ("length %zu: %.1f ns, scalar %.1f ns\n", length,
+                   vectorized * 1e9, scalar * 1e9);
+    }
+  return mismatches != 0;
+}
@@ -0,0 +1,39 @@
+// Suggests flags for unknown flags among 2000 registered ones with
+// `Flag_Set::suggest`, including the worst case of a 1 MiB flag, compared to
+// computing the similarity to every flag.
+#include "bench.hh"
+
+int
+main ()
+{
+  constexpr int FLAGS = 2000;
+  std::vector<std::string> names;
+  for (int i = 0; i < FLAGS; ++i)
+    names.push_back ("option-name-" + std::to_string (i * 7919 % 100000));
+  const auto values = std::make_unique<bool[]> (FLAGS);
+  flag::Flag_Set set;
+  for (int i = 0; i < FLAGS; ++i)
+    set.add (values[i], names[i]);
+  set.freeze ();
+
+  const std::string unknown[] = {"optoin-name-1234", std::string (300, 'x'),
+                                 std::string (1 << 20, 'o')};
+  for (const std::string &flag : unknown)
+    {
+      const int runs = flag.size () > 1000 ? 3 : 200;
+      std::string_view suggestions[3];
+      std::size_t found = 0;
+      const double indexed = bench::seconds_per_run (runs, [&] {
+        found = set.suggest (flag, suggestions);
+      });
+      const double scan = bench::seconds_per_run (runs, [&] {
+        double best = 0;
+        for (const std::string &name : names)
+          best = std::max (best, flag::similarity (flag, name));
+        bench::keep (best);
+      });
+      std::printf ("%zu byte flag: %.2f us for %zu suggestions, %.2f us to "
+                   "compare it to every flag\n", flag.size (), indexed * 1e6,
+                   found, scan * 1e6);
+    }
+}
@@ -0,0 +1,111 @@
+// Splits 4 KiB and 64 KiB command strings with `flag::tokenize`, into a
+// separate buffer and in place, compared to a character by character
+// tokenizer building a `std::string` per argument, checking that both agree.
+#include <cstring>
+#include <random>
+#include "bench.hh"
+
+// The ad hoc tokenizer, following the same quoting rules.
+static std::vector<std::string>
+split_strings (std::string_view command)
+{
+  std::vector<std::string> args;
+  std::string arg;
+  bool in_arg = false;
+  char quote = 0;
+  for (std::size_t i = 0; i < command.size (); ++i)
+    {
+      const char c = command[i];
+      if (quote == '\'')
+        {
+          if (c == '\'')
+            quote = 0;
+          else
+            arg += c;
+        }
+      else if (quote == '"')
+        {
+          if (c == '"')
+            quote = 0;
+          else if (c == '\\' && i + 1 < command.size ()
+                   && std::strchr ("$`\"\\\n", command[i + 1]))
+            arg += command[++i];
+          else
+            arg += c;
+        }
+      else if (c == ' ' || c == '\t' || c == '\n')
+        {
+          if (in_arg)
+            args.push_back (std::move (arg));
+          arg.clear ();
+          in_arg = false;
+        }
+      else
+        {
+          in_arg = true;
+          if (c == '\'' || c == '"')
+            quote = c;
+          else if (c == '\\' && i + 1 < command.size ())
+            arg += command[++i];
+          else
+            arg += c;
+        }
+    }
+  if (in_arg)
+    args.push_back (std::move (arg));
+  return args;
+}
+
+int
+main ()
+{
+  const char *const words[] = {
+    "--input=/srv/data/shard-000123.parquet", "-n", "5", "--color=auto",
+    "'a b c'", "\"quoted \\\"value\\\" here\"", "--label=team\\ infra", "-v",
+    "--output", "/tmp/out/result.json", "--filter='status == \"ok\"'",
+    "--retries=3"};
+  std::mt19937 random (7);
+  for (const std::size_t size : {std::size_t {4096}, std::size_t {65536}})
+    {
+      std::string command = "tool";
+      while (command.size () < size)
+        {
+          command += ' ';
+          command += words[random () % std::size (words)];
+        }
+      std::vector<char> buffer (command.size ());
+      std::string copy;
+
+      const std::vector<std::string> expected = split_strings (command);
+      std::string joined;
+      for (const std::string &arg : expected)
+        joined.append (arg).push_back ('\0');
+      const std::string_view tokens = flag::tokenize (command, buffer).buffer;
+      if (tokens != std::string_view (joined).substr (0, tokens.size ())
+          || joined.size () - tokens.size () > 1)
+        {
+          std::printf ("%zu bytes: the arguments differ\n", command.size ());
+          return 1;
+        }
+
+      const int runs = size < 10000 ? 20000 : 1500;
+      const double into_buffer = bench::seconds_per_run (runs, [&] {
+        bench::keep (flag::tokenize (command, buffer));
+      });
+      const double in_place = bench::seconds_per_run (runs, [&] {
+        copy = command;
+        bench::keep (flag::tokenize (std::span<char> (copy.data (),
+                                                      copy.size ())));
+      });
+      const double strings = bench::seconds_per_run (runs, [&] {
+        bench::keep (split_strings (command));
+      });
+      const auto gb_per_second = [&command] (double seconds) {
+        return command.size () / seconds / 1e9;
+      };
+      std::printf ("%zu bytes: %.2f GB/s into a buffer, %.2f GB/s in place "
+                   "(with copying the command), %.2f GB/s into strings\n",
+                   command.size (), gb_per_second (into_buffer),
+                   gb_per_second (in_place), gb_per_second (strings));
+    }
+}
@@ -31,11 +31,10 @@ struct Value_Type<my_custom_type>
   static constexpr const char *value_name = "key:value";
 
   // Responsible for converting the argument and writing the result to the
-  // given pointer
-  static void convert_arg (const char *arg_, my_custom_type *value)
+  // given pointer (the argument is not necessarily null-terminated)
+  static void convert_arg (std::string_view arg, my_custom_type *value)
   {
     const char *exception_msg = "my_custom_type must be of format 'key:value'";
-    std::string_view arg = arg_;
     const std::size_t colon_pos = arg.find (':');
     if (colon_pos == std::string_view::npos)
       throw std::invalid_argument (exception_msg);
@@ -83,8 +82,7 @@ main (const int argc, const char **argv)
       return true;
     }, "foo", "Print value");
   // Callable only accepting specific values
-  flag::add ([] (const char *arg_) {
-      const std::string_view arg = arg_;
+  flag::add ([] (std::string_view arg) {
       if ("yes"sv == arg || "always"sv == arg || "force"sv == arg
           || "no"sv == arg || "never"sv == arg || "none"sv == arg
           || "auto"sv == arg || "tty"sv == arg || "if-tty"sv == arg)
@@ -4,23 +4,136 @@
 #include <memory>
 #include <limits>
 #include <algorithm>
+#include <numeric>
 #include <iterator>
 #include <cstdlib>
 #include <cctype>
 #include <iostream>
 #include <map>
+#include <memory_resource>
+#include <cstdint>
+#include <array>
+#include <tuple>
+#include <bit>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <span>
+#include <system_error>
+#include <charconv>
+#include <cstring>
+#include <cerrno>
+#include <cmath>
+#include <stdexcept>
+#include <new>
+#include <utility>
 #if defined (_WIN32) && defined (FLAG_SHORTEN_WINDOWS_PROGRAM_PATH)
 #  include <filesystem>
 #endif
+#if defined (__SSE2__)
+#  include <emmintrin.h>
+#endif
+#if defined (__unix__) || defined (__APPLE__)
+#  include <fcntl.h>
+#  include <sys/ioctl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <sys/uio.h>
+#  include <unistd.h>
+#  define FLAG_POSIX 1
+#else
+#  include <filesystem>
+#  include <fstream>
+#endif
 
 namespace flag
 {
-using Option_Callable = std::function<bool (const char *)>;
+/// Called with the value of a flag.  The value is only valid during the call
+/// if it comes from a response file (see `Flag_Set::allow_response_files`),
+/// a callback keeping it has to copy it.
+using Option_Callable = std::function<bool (std::string_view)>;
 
 using Help_Function = std::function<void (const char *)>;
 
 using Collect_Arg = std::function<void (const char *)>;
 
+/// Receives the candidates for shell completion.
+using Complete_Function = std::function<void (std::string_view)>;
+
+/// The result of processing a flag or parsing a command line.
+enum class Process_Result
+{
+  Ok,
+  Invalid_Option,
+  Missing_Value,
+  Unexpected_Value,
+  Invalid_Value,
+  // The flag is an abbreviation of more than one flag.
+  Ambiguous_Option,
+  // A response file could not be read, see `Flag_Set::allow_response_files`.
+  Invalid_Response_File,
+  // The help flag was given, only returned for whole command lines.
+  Help,
+  // Shell completion was requested, only returned for whole command lines.
+  Complete
+};
+
+/// Selects the `parse` overloads that permute argv instead of copying the
+/// non-flag arguments.
+struct Permute
+{
+  explicit Permute () = default;
+};
+
+inline constexpr Permute permute {};
+
+/// A command line given as one buffer of null-separated arguments, like
+/// `/proc/PID/cmdline`.  A null character at the end of the buffer does not
+/// start another argument.
+struct Null_Separated
+{
+  std::string_view buffer;
+};
+
+/// Why and where parsing a command line stopped.
+struct Parse_Error
+{
+  Process_Result result;
+  // The flag without leading dashes, for a group of single-character flags
+  // where only the last one failed this is that flag.
+  std::string_view flag;
+  std::string_view value;
+  // Index of the argv-element containing the flag.
+  int argind;
+};
+
+/// The result of the non-exiting `parse` overloads, modeled after
+/// `std::expected<void, Parse_Error>`.
+/// The help flag is reported as an error with the result
+/// `Process_Result::Help`.
+class Parse_Result
+{
+  Parse_Error error_;
+
+public:
+  constexpr Parse_Result ()
+  : error_ {Process_Result::Ok, {}, {}, 0}
+  {}
+
+  constexpr Parse_Result (const Parse_Error &error)
+  : error_ (error)
+  {}
+
+  constexpr bool has_value () const
+  { return error_.result == Process_Result::Ok; }
+
+  constexpr explicit operator bool () const
+  { return has_value (); }
+
+  constexpr const Parse_Error & error () const
+  { return error_; }
+};
+
 namespace detail
 {
 template <class T>
@@ -33,16 +146,197 @@ template <class T>
 constexpr bool is_string = (std::is_same_v<T, const char *>
                             || std::is_same_v<T, std::string>
                             || std::is_same_v<T, std::string_view>);
+
+/// Parses the magnitude of an integer: an optional `0x`, `0o` or `0b` prefix
+/// (or a leading `0` for octal), followed by digits which may be separated
+/// by single `'` or `_` characters.  The entire string has to be consumed.
+template <class U>
+static inline std::errc
+parse_magnitude (std::string_view arg, U &magnitude)
+{
+  int base = 10;
+  if (arg.size () > 1 && arg[0] == '0')
+    {
+      switch (arg[1] | 0x20)
+        {
+          break; case 'x': base = 16; arg.remove_prefix (2);
+          break; case 'o': base = 8; arg.remove_prefix (2);
+          break; case 'b': base = 2; arg.remove_prefix (2);
+          break; default: base = 8;
+        }
+    }
+  if (arg.empty ())
+    return std::errc::invalid_argument;
+  // Separators are removed into a local buffer so `from_chars` can still be
+  // used, the buffer fits any value with plenty of leading zeros.
+  char buffer[192];
+  if (arg.find_first_of ("'_") != std::string_view::npos)
+    {
+      std::size_t length = 0;
+      for (std::size_t i = 0; i < arg.size (); ++i)
+        {
+          if (arg[i] == '\'' || arg[i] == '_')
+            {
+              if (i == 0 || i + 1 == arg.size ()
+                  || arg[i - 1] == '\'' || arg[i - 1] == '_')
+                return std::errc::invalid_argument;
+              continue;
+            }
+          if (length == sizeof (buffer))
+            return std::errc::result_out_of_range;
+          buffer[length++] = arg[i];
+        }
+      arg = std::string_view (buffer, length);
+    }
+  const auto [end, error] = std::from_chars (arg.data (),
+                                             arg.data () + arg.size (),
+                                             magnitude, base);
+  if (error != std::errc {})
+    return error;
+  return end == arg.data () + arg.size () ? std::errc {}
+                                          : std::errc::invalid_argument;
+}
+
+/// Converts an integer argument with an optional sign, see `parse_magnitude`.
+template <class T>
+static inline std::errc
+parse_integer (std::string_view arg, T &value)
+{
+  using U = std::make_unsigned_t<T>;
+  bool negative = false;
+  if (!arg.empty () && (arg[0] == '-' || arg[0] == '+'))
+    {
+      negative = arg[0] == '-';
+      arg.remove_prefix (1);
+    }
+  U magnitude;
+  if (const auto error = parse_magnitude (arg, magnitude);
+      error != std::errc {})
+    return error;
+  if (negative)
+    {
+      if constexpr (std::is_unsigned_v<T>)
+        return magnitude == 0 ? (value = 0, std::errc {})
+                              : std::errc::result_out_of_range;
+      else
+        {
+          constexpr U limit = U (std::numeric_limits<T>::max ()) + 1;
+          if (magnitude > limit)
+            return std::errc::result_out_of_range;
+          // Negate in the unsigned type, the conversion is well defined for
+          // the minimum value as well.
+          value = static_cast<T> (U (0) - magnitude);
+        }
+    }
+  else
+    {
+      if (magnitude > U (std::numeric_limits<T>::max ()))
+        return std::errc::result_out_of_range;
+      value = static_cast<T> (magnitude);
+    }
+  return {};
+}
+
+/// Converts a floating-point argument: decimal or `0x` hexadecimal with an
+/// optional sign, `inf` or `nan`.  The conversion is exactly rounded and
+/// independent of the locale, the entire string has to be consumed.
+template <class T>
+static inline std::errc
+parse_float (std::string_view arg, T &value)
+{
+#if defined (__cpp_lib_to_chars)
+  bool negative = false;
+  if (!arg.empty () && (arg[0] == '-' || arg[0] == '+'))
+    {
+      negative = arg[0] == '-';
+      arg.remove_prefix (1);
+    }
+  auto format = std::chars_format::general;
+  if (arg.size () > 2 && arg[0] == '0' && (arg[1] | 0x20) == 'x')
+    {
+      format = std::chars_format::hex;
+      arg.remove_prefix (2);
+    }
+  // The sign was handled above, `from_chars` would accept a second one.
+  if (arg.empty () || arg[0] == '-')
+    return std::errc::invalid_argument;
+  T my_value;
+  const auto [end, error] = std::from_chars (arg.data (),
+                                             arg.data () + arg.size (),
+                                             my_value, format);
+  if (error != std::errc {})
+    return error;
+  if (end != arg.data () + arg.size ())
+    return std::errc::invalid_argument;
+  value = negative ? -my_value : my_value;
+  return {};
+#else
+  // `strtold` needs a null-terminated string.
+  const std::string copy (arg);
+  char *end;
+  errno = 0;
+  const long double my_value = std::strtold (copy.c_str (), &end);
+  if (end == copy.c_str () || end != copy.c_str () + copy.size ())
+    return std::errc::invalid_argument;
+  if (errno == ERANGE
+      || std::abs (my_value) > std::numeric_limits<T>::max ())
+    return std::errc::result_out_of_range;
+  value = static_cast<T> (my_value);
+  return {};
+#endif
+}
+
+/// Turns the error code of a `try_convert_arg` function into the exception
+/// thrown by the corresponding `convert_arg`.
+static inline void
+throw_conversion_error (std::errc error)
+{
+  if (error == std::errc::result_out_of_range)
+    throw std::range_error ("value out of range");
+  else if (error != std::errc {})
+    throw std::invalid_argument ("invalid value");
+}
 } // namespace detail
 
 namespace types
 {
+/// Specializations may provide
+/// `static std::errc try_convert_arg (std::string_view arg, T *value) noexcept`,
+/// which is used instead of `convert_arg` and reports invalid arguments by
+/// returning an error instead of throwing.
+///
+/// Arguments are not necessarily null-terminated.  Both functions may take a
+/// `const char *` instead, the argument is then copied into a null-terminated
+/// string first if it is not terminated already.  Either way the argument
+/// may only be valid during the call, if it is copied or comes from a
+/// response file, so a value must not keep referring to it.
+///
+/// For shell completion of values they may also provide
+/// `static void complete_arg (std::string_view prefix,
+///                            const flag::Complete_Function &add)`,
+/// calling `add` with the possible values (only those starting with `prefix`
+/// are used).
 template <class T, typename __enable_if_dummy=void>
 struct Value_Type
 {
   static constexpr bool is_supported = false;
   static constexpr const char *value_name = nullptr;
-  static void convert_arg (const char *arg, T *value) {}
+  static void convert_arg (std::string_view arg, T *value) {}
+};
+
+/// Boolean flags are set without a value, this only makes `bool` a supported
+/// type.
+template <>
+struct Value_Type<bool>
+{
+  static constexpr bool is_supported = true;
+  static constexpr const char *value_name = nullptr;
+
+  static std::errc try_convert_arg (std::string_view, bool *) noexcept
+  { return std::errc::invalid_argument; }
+
+  static void convert_arg (std::string_view arg, bool *value)
+  { detail::throw_conversion_error (try_convert_arg (arg, value)); }
 };
 
 template <class T>
@@ -51,20 +345,11 @@ struct Value_Type<T, std::enable_if_t<detail::is_signed_int<T>>>
   static constexpr bool is_supported = true;
   static constexpr const char *value_name = "int";
 
-  static void convert_arg (const char *arg, T *value)
-  {
-    // FIXME (same for unsigned): this implementation will
-    // accept any non-number argument or arguments starting
-    // with a number and then containing garbage, in which
-    // case the value will just be set to 0 or that starting
-    // number and no error is reported.
-    const long long my_value = std::strtoll (arg, nullptr, 0);
-    if (my_value > std::numeric_limits<T>::max ())
-      throw std::range_error ("value too large");
-    else if (my_value < std::numeric_limits<T>::min ())
-      throw std::range_error ("value too small");
-    *value = static_cast<T> (my_value);
-  }
+  static std::errc try_convert_arg (std::string_view arg, T *value) noexcept
+  { return detail::parse_integer (arg, *value); }
+
+  static void convert_arg (std::string_view arg, T *value)
+  { detail::throw_conversion_error (try_convert_arg (arg, value)); }
 };
 
 template <class T>
@@ -73,13 +358,11 @@ struct Value_Type<T, std::enable_if_t<detail::is_unsigned_int<T>>>
   static constexpr bool is_supported = true;
   static constexpr const char *value_name = "unsigned";
 
-  static void convert_arg (const char *arg, T *value)
-  {
-    const unsigned long long my_value = std::strtoull (arg, nullptr, 0);
-    if (my_value > std::numeric_limits<T>::max ())
-      throw std::range_error ("value too large");
-    *value = static_cast<T> (my_value);
-  }
+  static std::errc try_convert_arg (std::string_view arg, T *value) noexcept
+  { return detail::parse_integer (arg, *value); }
+
+  static void convert_arg (std::string_view arg, T *value)
+  { detail::throw_conversion_error (try_convert_arg (arg, value)); }
 };
 
 template <class T>
@@ -88,11 +371,11 @@ struct Value_Type<T, std::enable_if_t<std::is_floating_point_v<T>>>
   static constexpr bool is_supported = true;
   static constexpr const char *value_name = "float";
 
-  static void convert_arg (const char *arg, T *value)
-  {
-    const double my_value = std::strtod (arg, nullptr);
-    *value = static_cast<T> (my_value);
-  }
+  static std::errc try_convert_arg (std::string_view arg, T *value) noexcept
+  { return detail::parse_float (arg, *value); }
+
+  static void convert_arg (std::string_view arg, T *value)
+  { detail::throw_conversion_error (try_convert_arg (arg, value)); }
 };
 
 template <class T>
@@ -101,36 +384,242 @@ struct Value_Type<T, std::enable_if_t<detail::is_string<T>>>
   static constexpr bool is_supported = true;
   static constexpr const char *value_name = "string";
 
-  static void convert_arg (const char *arg, T *value)
+  /// A `const char *` points into the argument, so it can only be set from
+  /// null-terminated arguments or copies of them (see
+  /// `detail::convert_arg`).
+  static std::errc try_convert_arg (std::string_view arg, T *value) noexcept
   {
-    *value = arg;
+    if constexpr (std::is_same_v<T, const char *>)
+      *value = arg.data ();
+    else
+      *value = arg;
+    return {};
   }
+
+  static void convert_arg (std::string_view arg, T *value)
+  { try_convert_arg (arg, value); }
 };
 
 } // namespace types
 
 namespace detail
 {
-struct Option_Base
-{
-  std::string_view flag_;
-  std::string_view help_text_;
+template <class T>
+concept has_try_convert = requires (std::string_view arg, T *value) {
+  { types::Value_Type<T>::try_convert_arg (arg, value) }
+    -> std::same_as<std::errc>;
+};
 
-  virtual ~Option_Base () {}
+/// A `try_convert_arg` taking a `const char *`.
+template <class T>
+concept has_c_string_try_convert = requires (const char *arg, T *value) {
+  { types::Value_Type<T>::try_convert_arg (arg, value) }
+    -> std::same_as<std::errc>;
+};
+
+template <class T>
+concept has_view_convert = requires (std::string_view arg, T *value) {
+  types::Value_Type<T>::convert_arg (arg, value);
+};
+
+template <class T>
+concept has_complete = requires (std::string_view prefix,
+                                 const Complete_Function &add) {
+  types::Value_Type<T>::complete_arg (prefix, add);
+};
 
-  Option_Base (std::string_view flag, std::string_view help_text)
-  : flag_ (flag), help_text_ (help_text)
+/// Copies of the arguments from response files that are kept after the file
+/// is released: the values of string flags pointing into the argument and
+/// the non-flag arguments passed to collectors that may keep them.  They are
+/// allocated from the resource given to `Flag_Set::allow_response_files` if
+/// any, otherwise they live until the flag set is destroyed.
+class String_Store
+{
+  std::mutex mutex_;
+  std::pmr::monotonic_buffer_resource strings_;
+  std::pmr::memory_resource *resource_ = &strings_;
+
+public:
+  explicit String_Store (std::pmr::memory_resource *resource)
+  : strings_ (resource)
   {}
 
-  std::string_view flag () const { return flag_; }
-  std::string_view help_text () const { return help_text_; }
+  /// Allocates the copies from `resource`, or from the store itself if null.
+  void use (std::pmr::memory_resource *resource)
+  {
+    std::lock_guard lock (mutex_);
+    resource_ = resource ? resource : &strings_;
+  }
+
+  /// Returns a null-terminated copy of `arg`.
+  const char * intern (std::string_view arg)
+  {
+    std::lock_guard lock (mutex_);
+    auto *copy = static_cast<char *> (resource_->allocate (arg.size () + 1,
+                                                           1));
+    std::memcpy (copy, arg.data (), arg.size ());
+    copy[arg.size ()] = '\0';
+    return copy;
+  }
+};
+
+/// Calls `f` with the argument as a null-terminated string, for value types
+/// and callbacks taking a `const char *`.  It is only copied if `terminated`
+/// is false, i.e. if it is not followed by a null character already.
+template <class F>
+static inline bool
+with_c_string (std::string_view arg, bool terminated, F &&f)
+{
+  if (terminated)
+    return f (arg.data ());
+  const std::string copy (arg);
+  return f (copy.c_str ());
+}
+
+/// Converts an argument using the `try_convert_arg` function of the value
+/// type if it has one and its `convert_arg` function otherwise.
+/// `terminated` is whether the argument is followed by a null character.
+/// If `store` is set the argument is released after the conversion, so
+/// strings pointing into it get a copy from `store` instead.
+/// Returns whether the argument was valid.
+template <class T>
+static inline bool
+convert_arg (std::string_view arg, bool terminated, T *value,
+             String_Store *store = nullptr)
+{
+  using Type = types::Value_Type<T>;
+  if constexpr (std::is_same_v<T, const char *>
+                || std::is_same_v<T, std::string_view>)
+    if (store)
+      {
+        arg = {store->intern (arg), arg.size ()};
+        terminated = true;
+      }
+  if constexpr (std::is_same_v<T, const char *>)
+    if (!terminated)
+      return false;
+  if constexpr (has_try_convert<T>)
+    return Type::try_convert_arg (arg, value) == std::errc {};
+  else if constexpr (has_c_string_try_convert<T>)
+    return with_c_string (arg, terminated, [value] (const char *c_string) {
+      return Type::try_convert_arg (c_string, value) == std::errc {};
+    });
+  else
+    {
+      try
+        {
+          if constexpr (has_view_convert<T>)
+            Type::convert_arg (arg, value);
+          else
+            with_c_string (arg, terminated, [value] (const char *c_string) {
+              Type::convert_arg (c_string, value);
+              return true;
+            });
+        }
+      catch (const std::exception &)
+        {
+          return false;
+        }
+      return true;
+    }
+}
+
+/// The type of an option.  Options of builtin types are converted through a
+/// switch on this, only other value types use the virtual `Option_Base`.
+enum class Option_Kind : std::uint8_t
+{
+  Bool,
+  Char,
+  Signed_Char,
+  Unsigned_Char,
+  Short,
+  Unsigned_Short,
+  Int,
+  Unsigned,
+  Long,
+  Unsigned_Long,
+  Long_Long,
+  Unsigned_Long_Long,
+  Float,
+  Double,
+  Long_Double,
+  C_String,
+  String,
+  String_View,
+  Callable,
+  Custom
+};
+
+template <class T>
+constexpr Option_Kind
+kind_of ()
+{
+  using K = Option_Kind;
+  if constexpr (std::is_same_v<T, bool>) return K::Bool;
+  else if constexpr (std::is_same_v<T, char>) return K::Char;
+  else if constexpr (std::is_same_v<T, signed char>) return K::Signed_Char;
+  else if constexpr (std::is_same_v<T, unsigned char>) return K::Unsigned_Char;
+  else if constexpr (std::is_same_v<T, short>) return K::Short;
+  else if constexpr (std::is_same_v<T, unsigned short>) return K::Unsigned_Short;
+  else if constexpr (std::is_same_v<T, int>) return K::Int;
+  else if constexpr (std::is_same_v<T, unsigned>) return K::Unsigned;
+  else if constexpr (std::is_same_v<T, long>) return K::Long;
+  else if constexpr (std::is_same_v<T, unsigned long>) return K::Unsigned_Long;
+  else if constexpr (std::is_same_v<T, long long>) return K::Long_Long;
+  else if constexpr (std::is_same_v<T, unsigned long long>)
+    return K::Unsigned_Long_Long;
+  else if constexpr (std::is_same_v<T, float>) return K::Float;
+  else if constexpr (std::is_same_v<T, double>) return K::Double;
+  else if constexpr (std::is_same_v<T, long double>) return K::Long_Double;
+  else if constexpr (std::is_same_v<T, const char *>) return K::C_String;
+  else if constexpr (std::is_same_v<T, std::string>) return K::String;
+  else if constexpr (std::is_same_v<T, std::string_view>) return K::String_View;
+  else return K::Custom;
+}
+
+/// Calls `f` with the value pointer cast to the type of the given kind.
+/// Only for kinds with a value type other than `bool`, the callers handle
+/// `Bool`, `Callable` and `Custom` themselves.
+template <class F>
+static inline decltype (auto)
+visit_value (Option_Kind kind, void *value, F &&f)
+{
+  using K = Option_Kind;
+  switch (kind)
+    {
+      case K::Char: return f (static_cast<char *> (value));
+      case K::Signed_Char: return f (static_cast<signed char *> (value));
+      case K::Unsigned_Char: return f (static_cast<unsigned char *> (value));
+      case K::Short: return f (static_cast<short *> (value));
+      case K::Unsigned_Short: return f (static_cast<unsigned short *> (value));
+      case K::Int: return f (static_cast<int *> (value));
+      case K::Unsigned: return f (static_cast<unsigned *> (value));
+      case K::Long: return f (static_cast<long *> (value));
+      case K::Unsigned_Long: return f (static_cast<unsigned long *> (value));
+      case K::Long_Long: return f (static_cast<long long *> (value));
+      case K::Unsigned_Long_Long:
+        return f (static_cast<unsigned long long *> (value));
+      case K::Float: return f (static_cast<float *> (value));
+      case K::Double: return f (static_cast<double *> (value));
+      case K::Long_Double: return f (static_cast<long double *> (value));
+      case K::C_String: return f (static_cast<const char **> (value));
+      case K::String: return f (static_cast<std::string *> (value));
+      case K::String_View: return f (static_cast<std::string_view *> (value));
+      case K::Bool: case K::Callable: case K::Custom: break;
+    }
+  return f (static_cast<bool *> (value));
+}
 
-  bool operator== (std::string_view test) const
-  { return flag_ == test; }
+/// Options with a value type that is not builtin.
+struct Option_Base
+{
+  virtual ~Option_Base () {}
 
-  virtual bool parse_arg (const char *) = 0;
-  virtual bool takes_value () const = 0;
+  /// `terminated` is whether `arg` is followed by a null character.
+  virtual bool parse_arg (std::string_view arg, bool terminated) const = 0;
   virtual const char * value_name () const = 0;
+  virtual void complete_arg (std::string_view, const Complete_Function &) const
+  {}
 };
 
 template <class T>
@@ -138,88 +627,279 @@ struct Option_Type : Option_Base
 {
   T *value_;
 
-  Option_Type (T *value, std::string_view flag, std::string_view help_text)
-  : Option_Base (flag, help_text), value_ (value)
+  Option_Type (T *value)
+  : value_ (value)
   {}
 
-  bool parse_arg (const char *arg) override
-  {
-    types::Value_Type<T>::convert_arg (arg, value_);
-    return true;
-  }
-
-  bool takes_value () const override
-  { return true; }
+  bool parse_arg (std::string_view arg, bool terminated) const override
+  { return convert_arg (arg, terminated, value_); }
 
   const char * value_name () const override
   { return types::Value_Type<T>::value_name; }
+
+  void complete_arg (std::string_view prefix,
+                     const Complete_Function &add) const override
+  {
+    if constexpr (has_complete<T>)
+      types::Value_Type<T>::complete_arg (prefix, add);
+  }
 };
 
-template <>
-struct Option_Type<bool> : Option_Base
+/// A move-only replacement for `std::function` that stores callables of up to
+/// four pointers in size inside itself and larger ones in memory from a
+/// `std::pmr::memory_resource`.
+template <class Signature>
+class Inline_Function;
+
+template <class R, class... Args>
+class Inline_Function<R (Args...)>
 {
-  bool *value_;
-  const bool target_value_;
+  static constexpr std::size_t INLINE_SIZE = 4 * sizeof (void *);
 
-  Option_Type (bool *value, std::string_view flag, std::string_view help_text)
-  : Option_Base (flag, help_text), value_ (value), target_value_ (!*value_)
+  template <class F>
+  static constexpr bool fits_inline
+    = (sizeof (F) <= INLINE_SIZE
+       && alignof (F) <= alignof (std::max_align_t)
+       && std::is_nothrow_move_constructible_v<F>);
+
+  // Holds the callable itself or, if it does not fit, a pointer to it.
+  alignas (std::max_align_t) mutable unsigned char storage_[INLINE_SIZE];
+  R (*invoke_) (void *, Args...) = nullptr;
+  // Moves the callable to `to` or destroys it if that is null.
+  void (*manage_) (Inline_Function &self, Inline_Function *to) = nullptr;
+  std::pmr::memory_resource *resource_ = nullptr;
+
+  template <class F>
+  static F * heap_target (void *storage)
+  {
+    F *f;
+    std::memcpy (&f, storage, sizeof (f));
+    return f;
+  }
+
+  void take (Inline_Function &other) noexcept
+  {
+    if (other.manage_)
+      other.manage_ (other, this);
+    invoke_ = std::exchange (other.invoke_, nullptr);
+    manage_ = std::exchange (other.manage_, nullptr);
+    resource_ = other.resource_;
+  }
+
+public:
+  Inline_Function () = default;
+
+  Inline_Function (std::nullptr_t)
   {}
 
-  bool parse_arg (const char *) override
+  template <class F>
+    requires (!std::is_same_v<std::decay_t<F>, Inline_Function>
+              && std::is_invocable_r_v<R, std::decay_t<F> &, Args...>)
+  Inline_Function (F &&f, std::pmr::memory_resource *resource
+                            = std::pmr::get_default_resource ())
+  : resource_ (resource)
   {
-    *value_ = target_value_;
-    return true;
+    using D = std::decay_t<F>;
+    // Empty function pointers and wrappers like an empty `std::function` are
+    // stored as nothing.  Closures are not tested, their conversion to a
+    // function pointer is never null.
+    if constexpr (std::is_class_v<D>)
+      {
+        if constexpr (requires (const D &d) { d.operator bool (); })
+          if (!f)
+            return;
+      }
+    else if constexpr (std::is_constructible_v<bool, const D &>)
+      if (!f)
+        return;
+    if constexpr (fits_inline<D>)
+      {
+        ::new (static_cast<void *> (storage_)) D (std::forward<F> (f));
+        invoke_ = [] (void *storage, Args... args) -> R {
+          return std::invoke (*std::launder (static_cast<D *> (storage)),
+                              std::forward<Args> (args)...);
+        };
+        manage_ = [] (Inline_Function &self, Inline_Function *to) {
+          D *target = std::launder (reinterpret_cast<D *> (self.storage_));
+          if (to)
+            ::new (static_cast<void *> (to->storage_)) D (std::move (*target));
+          target->~D ();
+        };
+      }
+    else
+      {
+        std::pmr::polymorphic_allocator<> allocator (resource);
+        D *target = allocator.new_object<D> (std::forward<F> (f));
+        std::memcpy (storage_, &target, sizeof (target));
+        invoke_ = [] (void *storage, Args... args) -> R {
+          return std::invoke (*heap_target<D> (storage),
+                              std::forward<Args> (args)...);
+        };
+        manage_ = [] (Inline_Function &self, Inline_Function *to) {
+          D *target = heap_target<D> (self.storage_);
+          if (to)
+            std::memcpy (to->storage_, &target, sizeof (target));
+          else
+            std::pmr::polymorphic_allocator<> (self.resource_)
+              .delete_object (target);
+        };
+      }
   }
 
-  bool takes_value () const override
-  { return false; }
+  Inline_Function (Inline_Function &&other) noexcept
+  { take (other); }
 
-  // Unused
-  const char * value_name () const override
-  { return nullptr; }
+  Inline_Function & operator= (Inline_Function &&other) noexcept
+  {
+    if (this != &other)
+      {
+        reset ();
+        take (other);
+      }
+    return *this;
+  }
+
+  Inline_Function & operator= (std::nullptr_t) noexcept
+  {
+    reset ();
+    return *this;
+  }
+
+  ~Inline_Function ()
+  { reset (); }
+
+  void reset () noexcept
+  {
+    if (manage_)
+      manage_ (*this, nullptr);
+    invoke_ = nullptr;
+    manage_ = nullptr;
+  }
+
+  explicit operator bool () const
+  { return invoke_ != nullptr; }
+
+  R operator() (Args... args) const
+  { return invoke_ (storage_, std::forward<Args> (args)...); }
 };
 
-template <>
-struct Option_Type<Option_Callable> : Option_Base
+/// Callables accepted by `Flag_Set::add`: taking the value as a
+/// `std::string_view` or as a `const char *`.
+template <class F>
+concept callback = (std::is_invocable_r_v<bool, F &, std::string_view>
+                    || std::is_invocable_r_v<bool, F &, const char *>);
+
+/// Wraps a callback to be stored in `Option_Table::callables`, callbacks
+/// taking a `const char *` get a null-terminated copy of values that are not
+/// terminated.
+template <class F>
+static inline auto
+adapt_callback (F &&f)
+{
+  using D = std::decay_t<F>;
+  return [f = D (std::forward<F> (f))] (std::string_view arg,
+                                        bool terminated) mutable -> bool {
+    if constexpr (std::is_invocable_r_v<bool, D &, std::string_view>)
+      return f (arg);
+    else
+      return with_c_string (arg, terminated, f);
+  };
+}
+
+/// Destroys an option allocated from the memory resource of its registry.
+struct Option_Deleter
+{
+  std::pmr::memory_resource *resource;
+  void (*destroy) (std::pmr::memory_resource *, Option_Base *);
+
+  void operator() (Option_Base *option) const
+  { destroy (resource, option); }
+};
+
+using Option_Ptr = std::unique_ptr<Option_Base, Option_Deleter>;
+
+template <class T>
+static inline Option_Ptr
+make_option (std::pmr::memory_resource *resource, T *value)
+{
+  std::pmr::polymorphic_allocator<> allocator (resource);
+  auto *option = allocator.new_object<Option_Type<T>> (value);
+  return Option_Ptr (option, {resource, [] (std::pmr::memory_resource *r,
+                                            Option_Base *o) {
+    std::pmr::polymorphic_allocator<> (r).delete_object (
+      static_cast<Option_Type<T> *> (o));
+  }});
+}
+
+/// Returned by lookups when there is no such option.
+inline constexpr std::uint32_t NO_OPTION = UINT32_MAX;
+
+/// The registered flags as a structure of arrays, so walks over all flags
+/// only touch the columns they need and the names are one contiguous string.
+struct Option_Table
 {
-  Option_Callable function_;
+  // All flag names back to back, name `i` is
+  // `[name_offsets[i], name_offsets[i + 1])`.
+  std::pmr::string names;
+  std::pmr::vector<std::uint32_t> name_offsets;
+  std::pmr::vector<std::string_view> help_texts;
+  std::pmr::vector<Option_Kind> kinds;
+  // The value for builtin types, null for callables and custom types.
+  std::pmr::vector<void *> values;
+  // Index into `callables` or `custom`, for boolean flags the value they set.
+  std::pmr::vector<std::uint32_t> indices;
+  // Called with the value and whether it is null-terminated.
+  std::pmr::vector<Inline_Function<bool (std::string_view, bool)>> callables;
+  std::pmr::vector<Option_Ptr> custom;
 
-  Option_Type (Option_Callable function, std::string_view flag,
-               std::string_view help_text)
-  : Option_Base (flag, help_text), function_ (function)
+  explicit Option_Table (std::pmr::memory_resource *resource)
+  : names (resource), name_offsets (1, 0, resource), help_texts (resource),
+    kinds (resource), values (resource), indices (resource),
+    callables (resource), custom (resource)
   {}
 
-  bool parse_arg (const char *arg) override
-  { return function_ (arg); }
+  std::size_t size () const
+  { return kinds.size (); }
 
-  bool takes_value () const override
-  { return true; }
+  std::string_view name (std::size_t i) const
+  {
+    return std::string_view (names).substr (name_offsets[i],
+                                            name_offsets[i + 1]
+                                            - name_offsets[i]);
+  }
 
-  const char * value_name () const override
-  { return nullptr; }
+  bool takes_value (std::size_t i) const
+  { return kinds[i] != Option_Kind::Bool; }
+
+  void push_back (std::string_view name, std::string_view help_text,
+                  Option_Kind kind, void *value, std::uint32_t index)
+  {
+    names.append (name);
+    name_offsets.push_back (static_cast<std::uint32_t> (names.size ()));
+    help_texts.push_back (help_text);
+    kinds.push_back (kind);
+    values.push_back (value);
+    indices.push_back (index);
+  }
 };
 
-inline std::vector<std::unique_ptr<Option_Base>> options = {};
-inline std::map<std::string_view, std::string_view> aliases = {};
-inline Help_Function usage = nullptr;
-inline std::string_view error_description = "";
-inline bool help_show_types = true;
-inline bool group_singles = false;
+// Set by callbacks through `flag::set_description` while parsing, so it is per
+// thread rather than per flag set.
+inline thread_local std::string_view error_description = "";
 
 static inline void
-print_type_name (Option_Base *option)
+append_type_name (std::pmr::string &out, const char *value_name,
+                  std::string_view flag_name)
 {
-  const char *value_name = option->value_name ();
-  std::cout << "\x1b[2m";
+  out += "\x1b[2m";
   if (value_name)
-    std::cout << value_name;
+    out += value_name;
   else
     {
       // If the option cannot provide it's own value name we use the flag in
       // uppercase.
-      const std::string_view flag_name = option->flag ();
       std::transform (flag_name.begin (), flag_name.end (),
-                      std::ostream_iterator<char> (std::cout),
+                      std::back_inserter (out),
                       [&] (char ch) -> char {
                         // Don't touch unicode
                         if (ch & 0x80)
@@ -227,325 +907,3477 @@ print_type_name (Option_Base *option)
                         return std::toupper (ch);
                       });
     }
-  std::cout << "\x1b[0m";
+  out += "\x1b[0m";
 }
 
-static void
-default_usage (const char *program)
+/// FNV-1a hash of a flag name.
+constexpr std::uint64_t
+hash_flag (std::string_view flag)
 {
-  std::cout << "Usage: " << program << " ...\n";
-  for (auto &option : options)
+  std::uint64_t h = 0xcbf29ce484222325ull;
+  for (const char ch : flag)
     {
-      std::cout << "    -" << option->flag ();
-      if (!aliases.empty ())
-        {
-          // TODO: support multiple aliases for the same flag
-          const auto flag = option->flag ();
-          const auto alias_it = std::find_if (aliases.begin (), aliases.end (),
-                                              [&flag](const auto &check) {
-                                                return check.second == flag;
-                                              });
-          if (alias_it != aliases.end ())
-            std::cout << ", -" << alias_it->first;
-        }
-      if (help_show_types && option->takes_value ())
-        {
-          std::cout << ' ';
-          print_type_name (option.get ());
-        }
-      std::cout << '\n';
-      if (!option->help_text ().empty ())
-        std::cout << "        " << option->help_text () << '\n';
+      h ^= static_cast<unsigned char> (ch);
+      h *= 0x100000001b3ull;
     }
+  return h;
 }
 
-static Option_Base *
-find_option (std::string_view flag)
+/// Flat open-addressing hash table mapping flag names and aliases to their
+/// option.  Built once by `flag::freeze` so that a lookup is one hash and
+/// (usually) one string compare instead of a scan over all options.
+class Flag_Index
 {
-  auto do_find = [](std::string_view flag) {
-    return std::find_if (options.begin (), options.end (),
-                         [&flag] (const auto &test) {
-                           return test->operator== (flag);
-                         });
+  static constexpr std::uint32_t EMPTY = NO_OPTION;
+
+  struct Slot
+  {
+    std::uint64_t hash;
+    std::string_view name;
+    std::uint32_t option;
   };
-  auto it = do_find (flag);
-  if (it == options.end ())
-    {
-      if (aliases.empty ())
-        return nullptr;
-      else
-        {
-          const auto alias_it = aliases.find (flag);
-          if (alias_it == aliases.end ()
-              || (it = do_find (alias_it->second)) == options.end ())
-            return nullptr;
-        }
-    }
-  return it->get ();
-}
 
-enum class Process_Result
-{
-  Ok,
-  Invalid_Option,
-  Missing_Value,
-  Unexpected_Value,
-  Invalid_Value
+  std::pmr::vector<Slot> slots_;
+  std::size_t mask_ = 0;
+
+  void insert (std::string_view name, std::uint32_t option)
+  {
+    const std::uint64_t h = hash_flag (name);
+    for (std::size_t i = h & mask_;; i = (i + 1) & mask_)
+      {
+        Slot &slot = slots_[i];
+        if (slot.option == EMPTY)
+          {
+            slot = {h, name, option};
+            return;
+          }
+        // The first definition wins, same as with the linear search.
+        if (slot.hash == h && slot.name == name)
+          return;
+      }
+  }
+
+public:
+  explicit Flag_Index (std::pmr::memory_resource *resource)
+  : slots_ (resource)
+  {}
+
+  void build (const Option_Table &opts,
+              const std::pmr::map<std::string_view, std::string_view> &alias_map)
+  {
+    // Keep the load factor at or below 1/2.
+    std::size_t capacity = 8;
+    while (capacity < 2 * (opts.size () + alias_map.size ()))
+      capacity *= 2;
+    slots_.assign (capacity, Slot {0, {}, EMPTY});
+    mask_ = capacity - 1;
+    for (std::size_t i = 0; i < opts.size (); ++i)
+      insert (opts.name (i), static_cast<std::uint32_t> (i));
+    // Aliases are resolved now, real flags take precedence over them.
+    for (const auto &[alias, flag] : alias_map)
+      if (const std::uint32_t option = find (flag); option != EMPTY)
+        insert (alias, option);
+  }
+
+  /// Returns the index of the option or `NO_OPTION` if there is none.
+  std::uint32_t find (std::string_view flag) const
+  {
+    if (slots_.empty ())
+      return EMPTY;
+    const std::uint64_t h = hash_flag (flag);
+    for (std::size_t i = h & mask_;; i = (i + 1) & mask_)
+      {
+        const Slot &slot = slots_[i];
+        if (slot.option == EMPTY || (slot.hash == h && slot.name == flag))
+          return slot.option;
+      }
+  }
 };
 
-static Process_Result
-process_flag (std::string_view flag, std::string_view &value,
-              int &argind, int argc, const char *const *argv)
+/// Maps flags and aliases consisting of a single codepoint to their option, for
+/// grouping.  ASCII characters are indexed directly, other codepoints are
+/// kept sorted by their UTF-8 bytes.
+class Short_Flag_Table
 {
-  Option_Base *option = find_option (flag);
-  if (option == nullptr)
-    return Process_Result::Invalid_Option;
-  if (option->takes_value ())
-    {
-      if (value.empty ())
-        {
-          if ((argind + 1) < argc)
-            value = argv[++argind];
-          else
-            return Process_Result::Missing_Value;
-        }
-      if (!option->parse_arg (value.data ()))
-        return Process_Result::Invalid_Value;
+  std::array<std::uint32_t, 128> ascii_;
+  std::pmr::vector<std::pair<std::uint32_t, std::uint32_t>> other_;
+
+  /// Packs a codepoint of up to 4 bytes into an integer, 0 if the given
+  /// string is longer.
+  static std::uint32_t key (std::string_view codepoint)
+  {
+    if (codepoint.size () > 4)
+      return 0;
+    std::uint32_t k = 0;
+    for (const char ch : codepoint)
+      k = (k << 8) | static_cast<unsigned char> (ch);
+    return k;
+  }
+
+  static bool is_single (std::string_view name)
+  {
+    return (!name.empty ()
+            && std::all_of (name.begin () + 1, name.end (), [] (char ch) {
+                 return (ch & 0xC0) == 0x80;
+               }));
+  }
+
+  void insert (std::string_view name, std::uint32_t option)
+  {
+    if (!is_single (name))
+      return;
+    // The first definition wins, same as in `Flag_Index`.
+    if (name.size () == 1 && !(name[0] & 0x80))
+      {
+        std::uint32_t &slot = ascii_[static_cast<unsigned char> (name[0])];
+        if (slot == NO_OPTION)
+          slot = option;
+      }
+    else if (const std::uint32_t k = key (name);
+             k != 0 && find (name) == NO_OPTION)
+      {
+        const auto it = std::lower_bound (other_.begin (), other_.end (),
+                                          std::make_pair (k, 0u));
+        other_.insert (it, {k, option});
+      }
+  }
+
+public:
+  explicit Short_Flag_Table (std::pmr::memory_resource *resource)
+  : other_ (resource)
+  { ascii_.fill (NO_OPTION); }
+
+  void build (const Option_Table &opts,
+              const std::pmr::map<std::string_view, std::string_view> &alias_map,
+              const Flag_Index &index)
+  {
+    ascii_.fill (NO_OPTION);
+    other_.clear ();
+    for (std::size_t i = 0; i < opts.size (); ++i)
+      insert (opts.name (i), static_cast<std::uint32_t> (i));
+    for (const auto &[alias, flag] : alias_map)
+      if (const std::uint32_t option = index.find (flag); option != NO_OPTION)
+        insert (alias, option);
+  }
+
+  /// Returns the option for a single codepoint or `NO_OPTION`.
+  std::uint32_t find (std::string_view codepoint) const
+  {
+    if (codepoint.size () == 1 && !(codepoint[0] & 0x80))
+      return ascii_[static_cast<unsigned char> (codepoint[0])];
+    const std::uint32_t k = key (codepoint);
+    const auto it = std::lower_bound (other_.begin (), other_.end (),
+                                      std::make_pair (k, 0u));
+    return it != other_.end () && it->first == k ? it->second : NO_OPTION;
+  }
+};
+
+/// All flag and alias names in sorted order with a trie over them, for
+/// finding every name starting with a given prefix in O(prefix length).
+class Prefix_Index
+{
+public:
+  struct Entry
+  {
+    std::string_view name;
+    std::uint32_t option;
+  };
+
+private:
+  struct Node
+  {
+    // The entries starting with the prefix of this node.
+    std::uint32_t first, last;
+    // The children are stored contiguously, ordered by their label.
+    std::uint32_t first_child, child_count;
+  };
+
+  std::pmr::vector<Entry> entries_;
+  std::pmr::vector<Node> nodes_;
+  // The byte leading to each node, parallel to `nodes_`.
+  std::pmr::vector<unsigned char> labels_;
+
+public:
+  explicit Prefix_Index (std::pmr::memory_resource *resource)
+  : entries_ (resource), nodes_ (resource), labels_ (resource)
+  {}
+
+  bool empty () const
+  { return nodes_.empty (); }
+
+  void clear ()
+  {
+    entries_.clear ();
+    nodes_.clear ();
+    labels_.clear ();
+  }
+
+  void build (const Option_Table &opts,
+              const std::pmr::map<std::string_view, std::string_view> &alias_map,
+              const Flag_Index &index)
+  {
+    clear ();
+    // Only keep the first definition of each name: every entry of a name
+    // gets the option `Flag_Index` resolves it to, so the entries of a name
+    // are equal in any order.  That allows `std::sort`, `std::stable_sort`
+    // would take its buffer from the heap instead of the set's resource.
+    for (std::size_t i = 0; i < opts.size (); ++i)
+      entries_.push_back ({opts.name (i), index.find (opts.name (i))});
+    for (const auto &[alias, flag] : alias_map)
+      if (index.find (flag) != NO_OPTION)
+        entries_.push_back ({alias, index.find (alias)});
+    const auto by_name = [] (const Entry &a, const Entry &b) {
+      return a.name < b.name;
+    };
+    std::sort (entries_.begin (), entries_.end (), by_name);
+    entries_.erase (std::unique (entries_.begin (), entries_.end (),
+                                 [] (const Entry &a, const Entry &b) {
+                                   return a.name == b.name;
+                                 }),
+                    entries_.end ());
+    // Built breadth-first so the children of each node end up next to each
+    // other.
+    std::pmr::vector<std::uint32_t> depths (entries_.get_allocator ());
+    nodes_.push_back ({0, static_cast<std::uint32_t> (entries_.size ()), 0, 0});
+    labels_.push_back (0);
+    depths.push_back (0);
+    for (std::size_t n = 0; n < nodes_.size (); ++n)
+      {
+        const std::uint32_t depth = depths[n];
+        const std::uint32_t last = nodes_[n].last;
+        std::uint32_t i = nodes_[n].first;
+        // Sorting puts the name equal to the prefix itself first.
+        if (i < last && entries_[i].name.size () == depth)
+          ++i;
+        nodes_[n].first_child = static_cast<std::uint32_t> (nodes_.size ());
+        while (i < last)
+          {
+            const char label = entries_[i].name[depth];
+            std::uint32_t j = i + 1;
+            while (j < last && entries_[j].name[depth] == label)
+              ++j;
+            nodes_.push_back ({i, j, 0, 0});
+            labels_.push_back (static_cast<unsigned char> (label));
+            depths.push_back (depth + 1);
+            i = j;
+          }
+        nodes_[n].child_count = (static_cast<std::uint32_t> (nodes_.size ())
+                                 - nodes_[n].first_child);
+      }
+  }
+
+  /// Returns all entries whose name starts with `prefix`.
+  std::span<const Entry> find (std::string_view prefix) const
+  {
+    if (nodes_.empty ())
+      return {};
+    std::uint32_t n = 0;
+    for (const char ch : prefix)
+      {
+        const auto label = static_cast<unsigned char> (ch);
+        const auto begin = labels_.begin () + nodes_[n].first_child;
+        const auto end = begin + nodes_[n].child_count;
+        const auto it = std::lower_bound (begin, end, label);
+        if (it == end || *it != label)
+          return {};
+        n = static_cast<std::uint32_t> (it - labels_.begin ());
+      }
+    return {entries_.data () + nodes_[n].first,
+            entries_.data () + nodes_[n].last};
+  }
+
+  /// Returns the option all of the given entries refer to or `NO_OPTION` if
+  /// there are none or they refer to different ones.
+  static std::uint32_t unique_option (std::span<const Entry> entries)
+  {
+    if (entries.empty ())
+      return NO_OPTION;
+    const std::uint32_t option = entries.front ().option;
+    for (const Entry &e : entries)
+      if (e.option != option)
+        return NO_OPTION;
+    return option;
+  }
+};
+
+/// Flag names sorted by their length, so only names whose length alone does
+/// not rule out being similar to an unknown flag need to be compared to it.
+class Length_Index
+{
+public:
+  // Minimum Jaro-Winkler similarity for a flag to be suggested.
+  static constexpr double THRESHOLD = 0.8;
+  // With at most `min (|a|, |b|)` matches and no transpositions the Jaro
+  // similarity of strings with these lengths is at most
+  // `0.333 * (min / max + 2)`, so the shorter one must be longer than this
+  // fraction of the longer one to reach the threshold.
+  static constexpr double MIN_LENGTH_RATIO = THRESHOLD / 0.333 - 2.0;
+
+  struct Entry
+  {
+    std::size_t length;
+    std::uint32_t option;
+  };
+
+private:
+  std::pmr::vector<Entry> entries_;
+
+public:
+  explicit Length_Index (std::pmr::memory_resource *resource)
+  : entries_ (resource)
+  {}
+
+  void build (const Option_Table &opts)
+  {
+    entries_.clear ();
+    for (std::size_t i = 0; i < opts.size (); ++i)
+      entries_.push_back ({opts.name (i).size (),
+                           static_cast<std::uint32_t> (i)});
+    // Not `std::stable_sort`, which takes its buffer from the heap instead
+    // of the set's memory resource.
+    std::sort (entries_.begin (), entries_.end (),
+               [] (const Entry &a, const Entry &b) {
+                 return (a.length != b.length ? a.length < b.length
+                                              : a.option < b.option);
+               });
+  }
+
+  /// Returns the names that may be similar enough to a flag of the given
+  /// length.  This is empty for flags much longer than any name, no matter
+  /// how long they are.
+  std::span<const Entry> candidates (std::size_t length) const
+  {
+    const auto n = static_cast<double> (length);
+    const auto first = std::partition_point (
+      entries_.begin (), entries_.end (), [n] (const Entry &e) {
+        return static_cast<double> (e.length) <= n * MIN_LENGTH_RATIO;
+      });
+    const auto last = std::partition_point (
+      first, entries_.end (), [n] (const Entry &e) {
+        return static_cast<double> (e.length) * MIN_LENGTH_RATIO < n;
+      });
+    return {first, last};
+  }
+};
+
+/// The aliases of each option.
+class Alias_Index
+{
+  // The aliases of option `i` are `names_[offsets_[i]:offsets_[i + 1]]`.
+  std::pmr::vector<std::uint32_t> offsets_;
+  std::pmr::vector<std::string_view> names_;
+
+public:
+  explicit Alias_Index (std::pmr::memory_resource *resource)
+  : offsets_ (resource), names_ (resource)
+  {}
+
+  void build (const Option_Table &opts,
+              const std::pmr::map<std::string_view, std::string_view> &alias_map,
+              const Flag_Index &index)
+  {
+    // Aliases shadowed by a flag or an earlier alias are left out.
+    const auto option_of = [&index] (const auto &alias) {
+      const std::uint32_t option = index.find (alias.second);
+      return (option != NO_OPTION && index.find (alias.first) == option
+              ? option : NO_OPTION);
+    };
+    offsets_.assign (opts.size () + 1, 0);
+    for (const auto &alias : alias_map)
+      if (const std::uint32_t option = option_of (alias); option != NO_OPTION)
+        ++offsets_[option + 1];
+    std::partial_sum (offsets_.begin (), offsets_.end (), offsets_.begin ());
+    names_.resize (offsets_.back ());
+    std::pmr::vector<std::uint32_t> next (offsets_.begin (),
+                                          offsets_.end () - 1,
+                                          offsets_.get_allocator ());
+    for (const auto &alias : alias_map)
+      if (const std::uint32_t option = option_of (alias); option != NO_OPTION)
+        names_[next[option]++] = alias.first;
+  }
+
+  std::span<const std::string_view> names (std::size_t option) const
+  {
+    if (option + 1 >= offsets_.size ())
+      return {};
+    return {names_.data () + offsets_[option],
+            names_.data () + offsets_[option + 1]};
+  }
+};
+
+/// Case-insensitive trigram index over the names, aliases and help texts of
+/// all options, for searching the help.  Trigrams are hashed into a fixed
+/// number of buckets so the index can be built with a counting sort, the
+/// candidates it returns must be checked by the caller.
+class Help_Index
+{
+  static constexpr std::size_t BUCKETS = std::size_t {1} << 16;
+
+  // The options containing a trigram of bucket `b` are
+  // `options_[offsets_[b]:offsets_[b + 1]]` in ascending order.
+  std::pmr::vector<std::uint32_t> offsets_;
+  std::pmr::vector<std::uint32_t> options_;
+
+  static std::size_t bucket (const char *str)
+  {
+    const std::uint32_t key
+      = (std::uint32_t {static_cast<unsigned char> (fold (str[0]))} << 16
+         | std::uint32_t {static_cast<unsigned char> (fold (str[1]))} << 8
+         | std::uint32_t {static_cast<unsigned char> (fold (str[2]))});
+    return (key * std::uint32_t {0x9E3779B1}) >> 16;
+  }
+
+  /// Calls `f (bucket, option)` for every trigram of every option.
+  template <class F>
+  static void for_each_trigram (const Option_Table &opts,
+                                const Alias_Index &aliases, F &&f)
+  {
+    const auto each = [&f] (std::string_view text, std::uint32_t option) {
+      for (std::size_t i = 0; i + 3 <= text.size (); ++i)
+        f (bucket (text.data () + i), option);
+    };
+    for (std::uint32_t i = 0; i < opts.size (); ++i)
+      {
+        each (opts.name (i), i);
+        for (const auto alias : aliases.names (i))
+          each (alias, i);
+        each (opts.help_texts[i], i);
+      }
+  }
+
+public:
+  static char fold (char ch)
+  { return ch >= 'A' && ch <= 'Z' ? ch - 'A' + 'a' : ch; }
+
+  explicit Help_Index (std::pmr::memory_resource *resource)
+  : offsets_ (resource), options_ (resource)
+  {}
+
+  bool empty () const
+  { return offsets_.empty (); }
+
+  void clear ()
+  {
+    offsets_.clear ();
+    options_.clear ();
+  }
+
+  void build (const Option_Table &opts, const Alias_Index &aliases)
+  {
+    // Options are visited in ascending order, so comparing with the last
+    // option seen for a bucket is enough to only count each one once.
+    std::pmr::vector<std::uint32_t> last (BUCKETS, NO_OPTION,
+                                          offsets_.get_allocator ());
+    offsets_.assign (BUCKETS + 1, 0);
+    for_each_trigram (opts, aliases, [&] (std::size_t b, std::uint32_t option) {
+      if (last[b] != option)
+        {
+          last[b] = option;
+          ++offsets_[b + 1];
+        }
+    });
+    std::partial_sum (offsets_.begin (), offsets_.end (), offsets_.begin ());
+    options_.resize (offsets_.back ());
+    std::fill (last.begin (), last.end (), NO_OPTION);
+    std::pmr::vector<std::uint32_t> next (offsets_.begin (),
+                                          offsets_.end () - 1,
+                                          offsets_.get_allocator ());
+    for_each_trigram (opts, aliases, [&] (std::size_t b, std::uint32_t option) {
+      if (last[b] != option)
+        {
+          last[b] = option;
+          options_[next[b]++] = option;
+        }
+    });
+  }
+
+  /// Returns the options that may contain the trigram at the start of `str`.
+  std::span<const std::uint32_t> find (const char *str) const
+  {
+    const std::size_t b = bucket (str);
+    return {options_.data () + offsets_[b],
+            options_.data () + offsets_[b + 1]};
+  }
+};
+
+/// The arguments being parsed: either the null-terminated strings given to
+/// `main` or string views, which need not be terminated.
+class Arg_List
+{
+  const char *const *c_strings_ = nullptr;
+  const std::string_view *views_ = nullptr;
+  bool terminated_ = true;
+  String_Store *store_ = nullptr;
+
+public:
+  Arg_List (const char *const *argv)
+  : c_strings_ (argv)
+  {}
+
+  /// `terminated` says whether every view is followed by a null character,
+  /// as are the strings in a null-separated buffer.  `store` is set if the
+  /// views are released after parsing, see `detail::convert_arg`.
+  Arg_List (const std::string_view *args, bool terminated = false,
+            String_Store *store = nullptr)
+  : views_ (args), terminated_ (terminated), store_ (store)
+  {}
+
+  std::string_view operator[] (int i) const
+  { return c_strings_ ? std::string_view (c_strings_[i]) : views_[i]; }
+
+  /// The first character of argument `i`, or a null character if it is
+  /// empty.  Unlike `operator[]` this does not measure C strings.
+  char front (int i) const
+  {
+    if (c_strings_)
+      return c_strings_[i][0];
+    return views_[i].empty () ? '\0' : views_[i][0];
+  }
+
+  /// Whether the arguments, and thereby the values taken from them, are
+  /// followed by a null character.
+  bool terminated () const
+  { return terminated_; }
+
+  /// Where values that keep referring to the arguments are copied, null if
+  /// the arguments outlive the parse.
+  String_Store * store () const
+  { return store_; }
+
+  /// Returns argument `i` as a C string, only valid if `terminated ()`.
+  const char * c_str (int i) const
+  { return c_strings_ ? c_strings_[i] : views_[i].data (); }
+};
+
+/// Identifies a response file for detecting cycles.
+using File_Id = std::pair<std::uint64_t, std::uint64_t>;
+
+/// The contents of a response file while its arguments are parsed.  Regular
+/// files are mapped read-only and unmapped when this is destroyed, others
+/// such as pipes are read into a buffer.
+class Response_File
+{
+  const char *data_ = nullptr;
+  std::size_t size_ = 0;
+  bool mapped_ = false;
+  std::pmr::vector<char> buffer_;
+
+public:
+  explicit Response_File (std::pmr::memory_resource *resource)
+  : buffer_ (resource)
+  {}
+
+  Response_File (const Response_File &) = delete;
+  Response_File & operator= (const Response_File &) = delete;
+
+  ~Response_File ()
+  {
+#if defined (FLAG_POSIX)
+    if (mapped_)
+      ::munmap (const_cast<char *> (data_), size_);
+#endif
+  }
+
+  /// Loads the file at `path`, setting `id`.  Returns the reason if it cannot
+  /// be read and null otherwise.
+  const char * load (const std::string &path, File_Id &id)
+  {
+#if defined (FLAG_POSIX)
+    const int fd = ::open (path.c_str (), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      return std::strerror (errno);
+    struct stat info;
+    const char *error = nullptr;
+    if (::fstat (fd, &info) != 0)
+      error = std::strerror (errno);
+    else
+      {
+        id = {static_cast<std::uint64_t> (info.st_dev),
+              static_cast<std::uint64_t> (info.st_ino)};
+        // The size of anything but a regular file says nothing about how
+        // much can be read from it.
+        if (S_ISREG (info.st_mode) && info.st_size != 0)
+          error = map (fd, static_cast<std::size_t> (info.st_size));
+        else if (!S_ISREG (info.st_mode))
+          error = read_all (fd);
+      }
+    ::close (fd);
+    return error;
+#else
+    std::ifstream stream (path, std::ios::binary);
+    if (!stream)
+      return "cannot be opened";
+    std::error_code ignored;
+    id = {std::hash<std::string> {} (
+            std::filesystem::weakly_canonical (path, ignored).string ()), 0};
+    buffer_.assign (std::istreambuf_iterator<char> (stream),
+                    std::istreambuf_iterator<char> ());
+    data_ = buffer_.data ();
+    size_ = buffer_.size ();
+    return nullptr;
+#endif
+  }
+
+  std::span<const char> contents () const
+  { return {data_, size_}; }
+
+private:
+#if defined (FLAG_POSIX)
+  const char * map (int fd, std::size_t size)
+  {
+    void *data = ::mmap (nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED)
+      return std::strerror (errno);
+    ::madvise (data, size, MADV_SEQUENTIAL);
+    data_ = static_cast<const char *> (data);
+    size_ = size;
+    mapped_ = true;
+    return nullptr;
+  }
+
+  const char * read_all (int fd)
+  {
+    constexpr std::size_t CHUNK = 64 * 1024;
+    std::size_t size = 0;
+    for (;;)
+      {
+        buffer_.resize (size + CHUNK);
+        const ::ssize_t n = ::read (fd, buffer_.data () + size, CHUNK);
+        if (n < 0 && errno == EINTR)
+          continue;
+        if (n < 0)
+          return std::strerror (errno);
+        if (n == 0)
+          break;
+        size += static_cast<std::size_t> (n);
+      }
+    data_ = buffer_.data ();
+    size_ = size;
+    return nullptr;
+  }
+#endif
+};
+
+/// The state of a `flag::Flag_Set`.
+struct Registry
+{
+  Option_Table options;
+  std::pmr::map<std::string_view, std::string_view> aliases;
+  Inline_Function<void (const char *)> usage;
+  bool use_default_usage = false;
+  bool help_show_types = true;
+  bool group_singles = false;
+  bool stop_at_args = false;
+  bool abbreviations = false;
+  bool completion = false;
+  bool expand_response_files = false;
+  // Number of similar flags suggested for an unknown flag, at most
+  // `MAX_SUGGESTIONS`.
+  std::size_t suggestions = 1;
+  // Caches of the options and aliases, built by `Flag_Set::freeze`.
+  mutable Flag_Index index;
+  mutable Short_Flag_Table singles;
+  // Built by `Flag_Set::freeze` if `abbreviations` is set, otherwise on the
+  // first completion.
+  mutable Prefix_Index prefixes;
+  mutable Length_Index lengths;
+  mutable Alias_Index alias_names;
+  // The output of the default usage function after the first line, rendered
+  // for `usage_width` columns on first use and cleared by `Flag_Set::freeze`.
+  mutable std::pmr::string usage_text;
+  mutable std::size_t usage_width = 0;
+  // Built on the first search of the help, cleared by `Flag_Set::freeze`.
+  mutable Help_Index help_index;
+  // Guards `usage_text`, `usage_width`, `help_index` and `prefixes` if it is
+  // built for completion.
+  mutable std::mutex usage_mutex;
+  // Copies of the arguments from response files that are kept.
+  mutable String_Store response_strings;
+
+  explicit Registry (std::pmr::memory_resource *resource)
+  : options (resource), aliases (resource), index (resource),
+    singles (resource), prefixes (resource), lengths (resource),
+    alias_names (resource), usage_text (resource), help_index (resource),
+    response_strings (resource)
+  {}
+};
+
+/// Sets the value of option `i`, `arg` is unused for boolean flags.
+/// `terminated` is whether `arg` is followed by a null character, `store`
+/// is set if it is released afterwards (see `convert_arg`).
+static inline bool
+parse_option (const Option_Table &options, std::uint32_t i,
+              std::string_view arg, bool terminated,
+              String_Store *store = nullptr)
+{
+  const Option_Kind kind = options.kinds[i];
+  switch (kind)
+    {
+      case Option_Kind::Bool:
+        *static_cast<bool *> (options.values[i]) = options.indices[i];
+        return true;
+      case Option_Kind::Callable:
+        return options.callables[options.indices[i]] (arg, terminated);
+      case Option_Kind::Custom:
+        return options.custom[options.indices[i]]->parse_arg (arg, terminated);
+      default:
+        return visit_value (kind, options.values[i],
+                            [arg, terminated, store] (auto *value) {
+          return convert_arg (arg, terminated, value, store);
+        });
+    }
+}
+
+static inline const char *
+value_name (const Option_Table &options, std::size_t i)
+{
+  const Option_Kind kind = options.kinds[i];
+  switch (kind)
+    {
+      case Option_Kind::Bool:
+      case Option_Kind::Callable:
+        return nullptr;
+      case Option_Kind::Custom:
+        return options.custom[options.indices[i]]->value_name ();
+      default:
+        return visit_value (kind, options.values[i], [] (auto *value) {
+          using T = std::remove_pointer_t<decltype (value)>;
+          return types::Value_Type<T>::value_name;
+        });
+    }
+}
+
+/// Returns the width of the terminal standard output is connected to or the
+/// value of the `COLUMNS` environment variable, 0 if neither is known.
+static inline std::size_t
+terminal_width ()
+{
+#if defined (FLAG_POSIX)
+  winsize size;
+  if (isatty (STDOUT_FILENO) && ioctl (STDOUT_FILENO, TIOCGWINSZ, &size) == 0
+      && size.ws_col > 0)
+    return size.ws_col;
+#endif
+  if (const char *columns = std::getenv ("COLUMNS"))
+    {
+      const std::string_view str = columns;
+      std::size_t width = 0;
+      std::from_chars (str.data (), str.data () + str.size (), width);
+      return width;
+    }
+  return 0;
+}
+
+/// Appends `text` indented by `indent` spaces, wrapped at word boundaries so
+/// lines don't exceed `width` columns.  Text is not wrapped if `width` is 0
+/// or leaves too little space after the indentation.
+static inline void
+append_wrapped (std::pmr::string &out, std::string_view text,
+                std::size_t indent, std::size_t width)
+{
+  constexpr std::size_t MIN_TEXT_WIDTH = 20;
+  const bool wrap = width >= indent + MIN_TEXT_WIDTH;
+  const auto columns = [] (std::string_view str) {
+    return std::size_t (std::count_if (str.begin (), str.end (), [] (char ch) {
+      return (ch & 0xC0) != 0x80;
+    }));
+  };
+  while (true)
+    {
+      const std::size_t eol = text.find ('\n');
+      std::string_view line = text.substr (0, eol);
+      out.append (indent, ' ');
+      if (!wrap)
+        out += line;
+      else
+        {
+          std::size_t used = 0;
+          while (!line.empty ())
+            {
+              const std::size_t space = line.find (' ');
+              const std::string_view word = line.substr (0, space);
+              const std::size_t word_columns = columns (word);
+              if (used > 0 && indent + used + 1 + word_columns > width)
+                {
+                  out += '\n';
+                  out.append (indent, ' ');
+                  used = 0;
+                }
+              else if (used > 0)
+                {
+                  out += ' ';
+                  ++used;
+                }
+              out += word;
+              used += word_columns;
+              line.remove_prefix (space == line.npos ? line.size () : space);
+              while (!line.empty () && line.front () == ' ')
+                line.remove_prefix (1);
+            }
+        }
+      out += '\n';
+      if (eol == text.npos)
+        break;
+      text.remove_prefix (eol + 1);
+    }
+}
+
+/// Renders the entry of option `i` in the default usage function.
+static inline void
+render_option (const Registry &registry, std::size_t i, std::size_t width,
+               std::pmr::string &out)
+{
+  const Option_Table &options = registry.options;
+  const auto flag = options.name (i);
+  out += "    -";
+  out += flag;
+  for (const auto alias : registry.alias_names.names (i))
+    {
+      out += ", -";
+      out += alias;
+    }
+  if (registry.help_show_types && options.takes_value (i))
+    {
+      out += ' ';
+      append_type_name (out, value_name (options, i), flag);
+    }
+  out += '\n';
+  if (!options.help_texts[i].empty ())
+    append_wrapped (out, options.help_texts[i], 8, width);
+}
+
+/// Renders the flag list of the default usage function.
+static inline void
+render_usage (const Registry &registry, std::size_t width,
+              std::pmr::string &out)
+{
+  for (std::size_t i = 0; i < registry.options.size (); ++i)
+    render_option (registry, i, width, out);
+}
+
+/// Returns the position of `pattern` in `text` ignoring ASCII case, or `npos`.
+static inline std::size_t
+find_folded (std::string_view text, std::string_view pattern)
+{
+  if (pattern.empty ())
+    return 0;
+  if (pattern.size () > text.size ())
+    return text.npos;
+  const char first = Help_Index::fold (pattern[0]);
+  const std::size_t last = text.size () - pattern.size ();
+  for (std::size_t i = 0; i <= last; ++i)
+    {
+      if (Help_Index::fold (text[i]) != first)
+        continue;
+      std::size_t k = 1;
+      while (k < pattern.size ()
+             && Help_Index::fold (text[i + k]) == Help_Index::fold (pattern[k]))
+        ++k;
+      if (k == pattern.size ())
+        return i;
+    }
+  return text.npos;
+}
+
+/// A flag or alias name of a `Schema` and the index of its flag.
+struct Static_Name
+{
+  std::string_view name;
+  std::size_t flag;
+};
+
+/// How a flag of a `Schema` takes its value.
+struct Static_Value
+{
+  bool takes_value;
+  // Calls `add` with the possible values as in `complete_value`, null if the
+  // value type does not provide them.
+  void (*complete_arg) (std::string_view prefix, const Complete_Function &add);
+};
+
+template <class T>
+constexpr Static_Value
+static_value ()
+{
+  if constexpr (has_complete<T>)
+    return {!std::is_same_v<T, bool>,
+            [] (std::string_view prefix, const Complete_Function &add) {
+              types::Value_Type<T>::complete_arg (prefix, add);
+            }};
+  else
+    return {!std::is_same_v<T, bool>, nullptr};
+}
+
+/// What the runtime functions know about the flags of a `Schema`, all of it
+/// generated at compile time.
+struct Static_Flags
+{
+  // The usage text, the entry of flag `i` is
+  // `text[offsets[i]:offsets[i + 1]]`.
+  std::string_view text = {};
+  std::span<const std::size_t> offsets = {};
+  // The name and help text of each flag.
+  std::span<const std::string_view> flags = {};
+  std::span<const std::string_view> help_texts = {};
+  std::span<const Static_Value> values = {};
+  // All flag and alias names, sorted.
+  std::span<const Static_Name> names = {};
+
+  /// Returns the names starting with `prefix`.
+  std::span<const Static_Name> with_prefix (std::string_view prefix) const
+  {
+    const auto first = std::partition_point (
+      names.begin (), names.end (), [prefix] (const Static_Name &n) {
+        return n.name < prefix;
+      });
+    const auto last = std::partition_point (
+      first, names.end (), [prefix] (const Static_Name &n) {
+        return n.name.starts_with (prefix);
+      });
+    return {first, last};
+  }
+};
+
+/// Finds the options whose name, aliases or help text contain `pattern`,
+/// ignoring ASCII case.  They are ranked by where the pattern was found:
+/// the name being the pattern, starting with it, containing it, an alias
+/// containing it and finally the help text containing it, ties are broken by
+/// the position of the match and then the order the flags were added in.
+/// The flags of the schema described by `static_flags` are ranked the same
+/// way and come first on ties, their indices are those of the schema;
+/// option `i` of the registry has index `static_flags.flags.size () + i`.
+static inline std::pmr::vector<std::uint32_t>
+search_help (const Registry &registry, std::string_view pattern,
+             std::pmr::memory_resource *resource,
+             const Static_Flags &static_flags = {})
+{
+  const Option_Table &options = registry.options;
+  const auto n_static = static_cast<std::uint32_t> (static_flags.flags.size ());
+  std::pmr::vector<std::uint32_t> result (resource);
+  // Every option containing the pattern contains its first trigram, for
+  // shorter patterns all options are candidates.
+  std::span<const std::uint32_t> candidates;
+  if (pattern.size () >= 3)
+    {
+      std::lock_guard lock (registry.usage_mutex);
+      if (registry.help_index.empty ())
+        registry.help_index.build (options, registry.alias_names);
+      // Use the rarest trigram of the pattern.
+      candidates = registry.help_index.find (pattern.data ());
+      for (std::size_t i = 1; i + 3 <= pattern.size (); ++i)
+        if (const auto c = registry.help_index.find (pattern.data () + i);
+            c.size () < candidates.size ())
+          candidates = c;
     }
   else
     {
-      if (!value.empty ())
-        return Process_Result::Unexpected_Value;
-      if (!option->parse_arg (nullptr))
-        return Process_Result::Invalid_Value;
+      result.resize (options.size ());
+      std::iota (result.begin (), result.end (), std::uint32_t {0});
+      candidates = std::span<const std::uint32_t> (result);
     }
-  return Process_Result::Ok;
+  struct Match
+  {
+    int tier;
+    std::size_t position;
+    std::uint32_t option;
+
+    bool operator< (const Match &other) const
+    {
+      return (std::tie (tier, position, option)
+              < std::tie (other.tier, other.position, other.option));
+    }
+  };
+  std::pmr::vector<Match> matches (resource);
+  // Adds the match of flag `i` for a name or, if that does not contain the
+  // pattern, the best alias position `alias` or the help text.
+  const auto rank = [&] (std::uint32_t i, std::string_view name,
+                         std::size_t alias, std::string_view help_text) {
+    if (const std::size_t pos = find_folded (name, pattern); pos != name.npos)
+      {
+        const int tier = (pos != 0 ? 2
+                          : name.size () == pattern.size () ? 0 : 1);
+        matches.push_back ({tier, pos, i});
+      }
+    else if (alias != std::string_view::npos)
+      matches.push_back ({3, alias, i});
+    else if (const std::size_t pos = find_folded (help_text, pattern);
+             pos != std::string_view::npos)
+      matches.push_back ({4, pos, i});
+  };
+  if (n_static != 0)
+    {
+      std::pmr::vector<std::size_t> aliases (n_static,
+                                             std::string_view::npos,
+                                             resource);
+      for (const Static_Name &entry : static_flags.names)
+        if (entry.name != static_flags.flags[entry.flag])
+          aliases[entry.flag] = std::min (aliases[entry.flag],
+                                          find_folded (entry.name, pattern));
+      for (std::uint32_t i = 0; i < n_static; ++i)
+        rank (i, static_flags.flags[i], aliases[i],
+              static_flags.help_texts[i]);
+    }
+  for (const std::uint32_t i : candidates)
+    {
+      std::size_t alias = std::string_view::npos;
+      for (const auto name : registry.alias_names.names (i))
+        alias = std::min (alias, find_folded (name, pattern));
+      rank (n_static + i, options.name (i), alias, options.help_texts[i]);
+    }
+  std::sort (matches.begin (), matches.end ());
+  result.clear ();
+  for (const Match &match : matches)
+    result.push_back (match.option);
+  return result;
+}
+
+/// Writes the given strings to standard output, with a single `writev` call
+/// where available.
+static inline void
+write_stdout (std::span<const std::string_view> parts)
+{
+#if defined (FLAG_POSIX)
+  std::cout.flush ();
+  constexpr std::size_t MAX_PARTS = 8;
+  std::array<iovec, MAX_PARTS> iov;
+  const std::size_t count = std::min (parts.size (), MAX_PARTS);
+  for (std::size_t i = 0; i < count; ++i)
+    iov[i] = {const_cast<char *> (parts[i].data ()), parts[i].size ()};
+  std::size_t first = 0;
+  while (first < count)
+    {
+      const ssize_t written = writev (STDOUT_FILENO, iov.data () + first,
+                                      static_cast<int> (count - first));
+      if (written < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          return;
+        }
+      // Skip what was written in case of a partial write.
+      auto left = static_cast<std::size_t> (written);
+      while (first < count && left >= iov[first].iov_len)
+        left -= iov[first++].iov_len;
+      if (first < count)
+        {
+          iov[first].iov_base = static_cast<char *> (iov[first].iov_base) + left;
+          iov[first].iov_len -= left;
+        }
+    }
+#else
+  for (const auto part : parts)
+    std::cout << part;
+  std::cout.flush ();
+#endif
 }
 
-// https://en.wikipedia.org/wiki/Jaro%E2%80%93Winkler_distance#Jaro_similarity
-static double
-jaro_similarity (std::string_view a, std::string_view b)
-{
-  // Note: This byte-wise processing does work for UTF-8 text, however
-  //       the text may need to be closer in appearance than with ascii
-  //       as characters using multiple bytes are treated the same as multiple
-  //       characters and therefore get a higher similarity penalty if they are
-  //       not equal.
+static void
+default_usage (const Registry &registry, const char *program,
+               const Static_Flags &static_flags = {})
+{
+  std::lock_guard lock (registry.usage_mutex);
+  const std::size_t width = terminal_width ();
+  if (registry.usage_text.empty () || registry.usage_width != width)
+    {
+      registry.usage_text.clear ();
+      render_usage (registry, width, registry.usage_text);
+      registry.usage_width = width;
+    }
+  const std::string_view parts[] = {
+    "Usage: ", program, " ...\n", static_flags.text, registry.usage_text
+  };
+  write_stdout (parts);
+}
+
+/// The default usage function for `-help=PATTERN`, only lists the flags
+/// matching `pattern` as ranked by `search_help`.
+static void
+default_usage (const Registry &registry, const char *program,
+               std::string_view pattern, const Static_Flags &static_flags = {})
+{
+  const auto options = search_help (registry, pattern,
+                                    registry.options.names.get_allocator ()
+                                      .resource (),
+                                    static_flags);
+  std::pmr::string text (registry.options.names.get_allocator ());
+  const std::size_t width = terminal_width ();
+  const std::size_t n_static = static_flags.flags.size ();
+  for (const std::uint32_t i : options)
+    if (i < n_static)
+      text += static_flags.text.substr (
+        static_flags.offsets[i],
+        static_flags.offsets[i + 1] - static_flags.offsets[i]);
+    else
+      render_option (registry, i - n_static, width, text);
+  if (text.empty ())
+    {
+      text += "No flags matching ‘";
+      text += pattern;
+      text += "’\n";
+    }
+  const std::string_view parts[] = {"Usage: ", program, " ...\n", text};
+  write_stdout (parts);
+}
+
+/// Prints the usage as for `-help`, or for `-help=PATTERN` if `pattern` is
+/// not empty.  Custom usage functions ignore the pattern.
+static inline void
+print_usage (const Registry &registry, const char *program,
+             std::string_view pattern, const Static_Flags &static_flags = {})
+{
+  if (registry.use_default_usage && !pattern.empty ())
+    default_usage (registry, program, pattern, static_flags);
+  else if (registry.use_default_usage)
+    default_usage (registry, program, static_flags);
+  else if (registry.usage)
+    registry.usage (program);
+}
+
+/// Calls `add` with the possible values of option `i` starting with `prefix`,
+/// provided by the `complete_arg` function of its value type.
+static inline void
+complete_value (const Option_Table &options, std::uint32_t i,
+                std::string_view prefix, const Complete_Function &add)
+{
+  const Complete_Function matching = [&] (std::string_view candidate) {
+    if (candidate.starts_with (prefix))
+      add (candidate);
+  };
+  switch (options.kinds[i])
+    {
+      case Option_Kind::Bool:
+      case Option_Kind::Callable:
+        break;
+      case Option_Kind::Custom:
+        options.custom[options.indices[i]]->complete_arg (prefix, matching);
+        break;
+      default:
+        visit_value (options.kinds[i], options.values[i], [&] (auto *value) {
+          using T = std::remove_pointer_t<decltype (value)>;
+          if constexpr (has_complete<T>)
+            types::Value_Type<T>::complete_arg (prefix, matching);
+        });
+    }
+}
+
+/// Writes the completions for the last of the given words to `out`, one per
+/// line.  The words are those of the command line without the program name,
+/// the last one is the word being completed.  Nothing is written if the
+/// word is not a flag or a value with known candidates, so the shell can fall
+/// back to completing files.  The flags of the schema described by
+/// `static_flags` are completed as well.
+static inline void
+complete_words (const Registry &registry,
+                std::span<const std::string_view> words, std::pmr::string &out,
+                const Static_Flags &static_flags = {})
+{
+  const Option_Table &options = registry.options;
+  if (!registry.abbreviations)
+    {
+      std::lock_guard lock (registry.usage_mutex);
+      if (registry.prefixes.empty ())
+        registry.prefixes.build (options, registry.aliases, registry.index);
+    }
+  // A flag of the registry or, if `option` is `NO_OPTION`, of the schema.
+  struct Found
+  {
+    std::uint32_t option = NO_OPTION;
+    std::size_t flag = std::string_view::npos;
+
+    bool takes_value (const Option_Table &options,
+                      const Static_Flags &static_flags) const
+    {
+      if (option != NO_OPTION)
+        return options.takes_value (option);
+      return (flag != std::string_view::npos
+              && static_flags.values[flag].takes_value);
+    }
+  };
+  // Returns the flag with the leading dashes removed, looked up like
+  // `process_abbreviation` does.
+  const auto lookup = [&] (std::string_view flag) -> Found {
+    const auto static_matches = static_flags.with_prefix (flag);
+    if (!static_matches.empty () && static_matches.front ().name == flag)
+      return {NO_OPTION, static_matches.front ().flag};
+    if (const std::uint32_t option = registry.index.find (flag);
+        option != NO_OPTION || !registry.abbreviations)
+      return {option};
+    const auto matches = registry.prefixes.find (flag);
+    if (static_matches.empty ())
+      return {Prefix_Index::unique_option (matches)};
+    for (const Static_Name &match : static_matches)
+      if (match.flag != static_matches.front ().flag)
+        return {};
+    return matches.empty () ? Found {NO_OPTION, static_matches.front ().flag}
+                            : Found {};
+  };
+  const auto complete_found = [&] (Found found, std::string_view prefix,
+                                   const Complete_Function &add) {
+    if (found.option != NO_OPTION)
+      complete_value (options, found.option, prefix, add);
+    else if (const auto complete_arg = static_flags.values[found.flag]
+                                         .complete_arg)
+      complete_arg (prefix, [&] (std::string_view candidate) {
+        if (candidate.starts_with (prefix))
+          add (candidate);
+      });
+  };
+  const auto line = [&out] (auto... parts) {
+    ((out += parts), ...);
+    out += '\n';
+  };
+  // Find out whether the last word is a flag, a value or neither.
+  bool flags_done = false;
+  // The flag whose value the next word is, if any.
+  Found pending;
+  const std::size_t last = words.empty () ? 0 : words.size () - 1;
+  for (std::size_t i = 0; i < last; ++i)
+    {
+      const std::string_view word = words[i];
+      if (pending.takes_value (options, static_flags))
+        pending = {};
+      else if (flags_done)
+        ;
+      else if (word == "--")
+        flags_done = true;
+      else if (word.size () < 2 || word[0] != '-')
+        flags_done = registry.stop_at_args;
+      else if (const std::string_view flag = word.substr (1 + (word[1] == '-'));
+               flag.find ('=') == flag.npos)
+        {
+          const Found found = lookup (flag);
+          if (found.takes_value (options, static_flags))
+            pending = found;
+        }
+    }
+  const std::string_view current = words.empty () ? "" : words[last];
+  if (pending.takes_value (options, static_flags))
+    complete_found (pending, current, [&] (std::string_view value) {
+      line (value);
+    });
+  else if (!flags_done && current.starts_with ('-'))
+    {
+      const std::string_view dash = current.starts_with ("--") ? "--" : "-";
+      const std::string_view flag = current.substr (dash.size ());
+      if (const std::size_t eq = flag.find ('='); eq != flag.npos)
+        {
+          const Found found = lookup (flag.substr (0, eq));
+          if (found.takes_value (options, static_flags))
+            complete_found (found, flag.substr (eq + 1),
+                            [&] (std::string_view value) {
+                              line (dash, flag.substr (0, eq + 1), value);
+                            });
+        }
+      else
+        {
+          for (const auto &entry : static_flags.with_prefix (flag))
+            line (dash, entry.name);
+          for (const auto &entry : registry.prefixes.find (flag))
+            line (dash, entry.name);
+          if ((registry.use_default_usage || registry.usage)
+              && std::string_view ("help").starts_with (flag))
+            line (dash, std::string_view ("help"));
+        }
+    }
+}
+
+/// Writes the script that hooks `program __complete` into the given shell
+/// (`bash`, `zsh` or `fish`).  Returns false for other shells.
+static inline bool
+completion_script (std::string_view shell, std::string_view program,
+                   std::pmr::string &out)
+{
+  program = program.substr (program.rfind ('/') + 1);
+  // Shell function names can't contain all characters file names can.
+  std::pmr::string function (out.get_allocator ());
+  function = "_";
+  for (const char ch : program)
+    function += std::isalnum (static_cast<unsigned char> (ch)) ? ch : '_';
+  function += "_complete";
+  const auto put = [&] (std::initializer_list<std::string_view> parts) {
+    for (const auto part : parts)
+      out += part;
+  };
+  if (shell == "bash")
+    put ({function, " ()\n"
+          "{\n"
+          "  local cur words cword IFS=$'\\n'\n"
+          "  if declare -F _init_completion >/dev/null; then\n"
+          "    _init_completion -n = || return\n"
+          "  else\n"
+          "    words=(\"${COMP_WORDS[@]}\"); cword=$COMP_CWORD\n"
+          "    cur=${words[cword]}\n"
+          "  fi\n"
+          "  COMPREPLY=($(", program,
+          " __complete \"${words[@]:1:cword}\" 2>/dev/null))\n"
+          "  # Readline only replaces the part after `=`.\n"
+          "  if [[ $cur == *=* && $COMP_WORDBREAKS == *=* ]]; then\n"
+          "    COMPREPLY=(\"${COMPREPLY[@]#*=}\")\n"
+          "  fi\n"
+          "}\n"
+          "complete -o default -F ", function, " ", program, "\n"});
+  else if (shell == "zsh")
+    put ({"#compdef ", program, "\n",
+          function, " ()\n"
+          "{\n"
+          "  local -a completions\n"
+          "  completions=(\"${(@f)$(", program,
+          " __complete \"${(@)words[2,CURRENT]}\" 2>/dev/null)}\")\n"
+          "  if (( ${#completions} )) && [[ -n ${completions[1]} ]]; then\n"
+          "    compadd -- \"${completions[@]}\"\n"
+          "  else\n"
+          "    _files\n"
+          "  fi\n"
+          "}\n"
+          "compdef ", function, " ", program, "\n"});
+  else if (shell == "fish")
+    put ({"function ", function, "\n"
+          "    set -l current (commandline -ct)\n"
+          "    set -l tokens (commandline -opc) \"$current\"\n"
+          "    ", program, " __complete $tokens[2..-1] 2>/dev/null\n"
+          "end\n"
+          "complete -c ", program, " -a '(", function, ")'\n"});
+  else
+    return false;
+  return true;
+}
+
+/// Answers a completion request, `argv[1]` is either `__complete` followed by
+/// the words to complete or `__completion` followed by the name of a shell
+/// to print the completion script for.  Returns false for an unknown shell.
+static inline bool
+complete (const Registry &registry, int argc, Arg_List argv,
+          const Static_Flags &static_flags = {})
+{
+  std::pmr::string out (registry.options.names.get_allocator ());
+  if (argv[1] == "__completion")
+    {
+      if (argc < 3 || !completion_script (argv[2], argv[0], out))
+        return false;
+    }
+  else
+    {
+      std::pmr::vector<std::string_view> words (out.get_allocator ());
+      words.reserve (static_cast<std::size_t> (std::max (argc - 2, 0)));
+      for (int i = 2; i < argc; ++i)
+        words.push_back (argv[i]);
+      complete_words (registry, words, out, static_flags);
+    }
+  const std::string_view parts[] = {out};
+  write_stdout (parts);
+  return true;
+}
+
+/// Returns the index of the option or `NO_OPTION`.
+static inline std::uint32_t
+find_option (const Registry &registry, std::string_view flag)
+{
+  return registry.index.find (flag);
+}
+
+template <std::size_t N>
+struct Fixed_String
+{
+  char data_[N] = {};
+
+  constexpr Fixed_String (const char (&str)[N])
+  { std::copy_n (str, N, data_); }
+
+  constexpr std::string_view view () const
+  { return {data_, N - 1}; }
+};
+
+/// Renders the usage text of a `Schema` during constant evaluation: it is
+/// run once without a buffer to count the characters and once more to fill
+/// a buffer of that size.
+struct Static_Writer
+{
+  char *data = nullptr;
+  std::size_t size = 0;
+
+  constexpr void put (char ch)
+  {
+    if (data)
+      data[size] = ch;
+    ++size;
+  }
+
+  constexpr void put (std::string_view str)
+  {
+    for (const char ch : str)
+      put (ch);
+  }
+};
+
+/// Compile-time minimal-probe perfect hash over a fixed set of flag names
+/// ("hash and displace"): the names are split into buckets by their hash and
+/// each bucket gets a seed that moves all of its names into free slots.
+/// A lookup is one hash of the name, one table load and one compare.
+template <std::size_t N>
+class Perfect_Hash
+{
+  static constexpr std::size_t buckets_ = N ? N : 1;
+  static constexpr std::size_t size_ = std::bit_ceil (2 * buckets_);
+  static constexpr int shift_ = 64 - std::countr_zero (size_);
+
+  std::array<std::string_view, N> names_ = {};
+  std::array<std::uint32_t, buckets_> seeds_ = {};
+  // Index into `names_` plus one, zero for an empty slot.
+  std::array<std::size_t, size_> slots_ = {};
+
+  static constexpr std::size_t slot (std::uint64_t h, std::uint32_t seed)
+  {
+    h ^= seed * 0x9e3779b97f4a7c15ull;
+    h *= 0xff51afd7ed558ccdull;
+    return static_cast<std::size_t> (h >> shift_);
+  }
+
+public:
+  constexpr Perfect_Hash (const std::array<std::string_view, N> &names)
+  : names_ (names)
+  {
+    std::array<std::uint64_t, N> hashes = {};
+    // The names of each bucket are `members[begin[b], begin[b + 1])`.
+    std::array<std::size_t, buckets_ + 1> begin = {};
+    std::array<std::size_t, N> members = {};
+    for (std::size_t i = 0; i < N; ++i)
+      {
+        hashes[i] = hash_flag (names[i]);
+        ++begin[hashes[i] % buckets_ + 1];
+      }
+    for (std::size_t b = 0; b < buckets_; ++b)
+      begin[b + 1] += begin[b];
+    {
+      std::array<std::size_t, buckets_> fill = {};
+      for (std::size_t i = 0; i < N; ++i)
+        {
+          const std::size_t b = hashes[i] % buckets_;
+          members[begin[b] + fill[b]++] = i;
+        }
+    }
+    // Equal names have equal hashes, so duplicates share a bucket.
+    for (std::size_t b = 0; b < buckets_; ++b)
+      for (std::size_t i = begin[b]; i < begin[b + 1]; ++i)
+        for (std::size_t j = begin[b]; j < i; ++j)
+          if (names[members[i]] == names[members[j]])
+            throw "duplicate flag name in schema";
+    // Place the largest buckets first while the table is still empty.
+    std::array<std::size_t, buckets_> order = {};
+    for (std::size_t b = 0; b < buckets_; ++b)
+      order[b] = b;
+    std::sort (order.begin (), order.end (),
+               [&begin] (std::size_t a, std::size_t b) {
+                 const std::size_t size_a = begin[a + 1] - begin[a];
+                 const std::size_t size_b = begin[b + 1] - begin[b];
+                 return size_a != size_b ? size_a > size_b : a < b;
+               });
+    std::array<std::size_t, N> taken = {};
+    for (const std::size_t b : order)
+      {
+        const std::size_t first = begin[b], last = begin[b + 1];
+        if (first == last)
+          break;
+        for (std::uint32_t seed = 0;; ++seed)
+          {
+            std::size_t n_taken = 0;
+            bool ok = true;
+            for (std::size_t i = first; i < last && ok; ++i)
+              {
+                const std::size_t s = slot (hashes[members[i]], seed);
+                ok = slots_[s] == 0;
+                for (std::size_t j = 0; j < n_taken && ok; ++j)
+                  ok = taken[j] != s;
+                taken[n_taken++] = s;
+              }
+            if (!ok)
+              continue;
+            seeds_[b] = seed;
+            for (std::size_t i = first; i < last; ++i)
+              slots_[slot (hashes[members[i]], seed)] = members[i] + 1;
+            break;
+          }
+      }
+  }
+
+  /// Returns the index of the given name or `N` if it is not in the set.
+  constexpr std::size_t find (std::string_view name) const
+  {
+    const std::uint64_t h = hash_flag (name);
+    const std::size_t i = slots_[slot (h, seeds_[h % buckets_])];
+    return (i != 0 && names_[i - 1] == name) ? i - 1 : N;
+  }
+};
+
+/// Makes sure a flag that takes a value has one, if it was not given inline
+/// using `=` the next argv-element is consumed.
+static inline bool
+fetch_value (std::string_view &value, int &argind, int argc, Arg_List argv)
+{
+  if (value.empty ())
+    {
+      if ((argind + 1) < argc)
+        value = argv[++argind];
+      else
+        return false;
+    }
+  return true;
+}
+
+/// Sets option `option` found for a flag, `value` is the value given inline
+/// using `=` if any.
+static Process_Result
+apply_option (const Registry &registry, std::uint32_t option,
+              std::string_view &value, int &argind, int argc, Arg_List argv)
+{
+  if (registry.options.takes_value (option))
+    {
+      if (!fetch_value (value, argind, argc, argv))
+        return Process_Result::Missing_Value;
+      if (!parse_option (registry.options, option, value, argv.terminated (),
+                         argv.store ()))
+        return Process_Result::Invalid_Value;
+    }
+  else
+    {
+      if (!value.empty ())
+        return Process_Result::Unexpected_Value;
+      if (!parse_option (registry.options, option, {}, true))
+        return Process_Result::Invalid_Value;
+    }
+  return Process_Result::Ok;
+}
+
+static Process_Result
+process_flag (const Registry &registry, std::string_view flag,
+              std::string_view &value, int &argind, int argc, Arg_List argv)
+{
+  const std::uint32_t option = find_option (registry, flag);
+  if (option == NO_OPTION)
+    return Process_Result::Invalid_Option;
+  return apply_option (registry, option, value, argind, argc, argv);
+}
+
+/// Processes a flag that is not a flag name by itself as an abbreviation of
+/// a flag in the registry or in the schema described by `static_flags`,
+/// whose flags are set through `process`.
+/// Returns the full name of the flag and the result of processing it, the
+/// given flag and `Process_Result::Invalid_Option` or
+/// `Process_Result::Ambiguous_Option` if it is not a unique prefix.
+template <class Process>
+static std::pair<std::string_view, Process_Result>
+process_abbreviation (const Registry &registry,
+                      const Static_Flags &static_flags, Process &process,
+                      std::string_view flag, std::string_view &value,
+                      int &argind, int argc, Arg_List argv)
+{
+  const auto matches = registry.prefixes.find (flag);
+  const auto static_matches = static_flags.with_prefix (flag);
+  if (static_matches.empty ())
+    {
+      if (matches.empty ())
+        return {flag, Process_Result::Invalid_Option};
+      const std::uint32_t option = Prefix_Index::unique_option (matches);
+      if (option == NO_OPTION)
+        return {flag, Process_Result::Ambiguous_Option};
+      return {registry.options.name (option),
+              apply_option (registry, option, value, argind, argc, argv)};
+    }
+  const std::size_t index = static_matches.front ().flag;
+  for (const Static_Name &match : static_matches)
+    if (match.flag != index)
+      return {flag, Process_Result::Ambiguous_Option};
+  if (!matches.empty ())
+    return {flag, Process_Result::Ambiguous_Option};
+  const std::string_view name = static_flags.flags[index];
+  return {name, process (name, value, argind, argc, argv)};
+}
+
+/// Number of leading bytes considered by `jaro_similarity`.
+inline constexpr std::size_t MAX_SIMILARITY_LENGTH = 256;
+
+/// Returns a mask with bit `k` set if `block[k] == c`, for 16 bytes.
+static inline std::uint32_t
+match_block (const char *block, char c)
+{
+#if defined (__SSE2__)
+  const __m128i bytes = _mm_loadu_si128 (
+    reinterpret_cast<const __m128i *> (block));
+  return static_cast<std::uint32_t> (
+    _mm_movemask_epi8 (_mm_cmpeq_epi8 (bytes, _mm_set1_epi8 (c))));
+#else
+  if constexpr (std::endian::native == std::endian::little)
+    {
+      // Compares 8 bytes at a time within an integer: the high bit of each
+      // byte of `eq` is set if that byte was equal to C, these bits are then
+      // gathered into the low byte by the multiplication.
+      constexpr std::uint64_t LOW = 0x7F7F7F7F7F7F7F7F;
+      constexpr std::uint64_t GATHER = 0x0102040810204080;
+      const std::uint64_t pattern
+        = 0x0101010101010101 * static_cast<unsigned char> (c);
+      std::uint32_t mask = 0;
+      for (int half = 0; half < 2; ++half)
+        {
+          std::uint64_t bytes;
+          std::memcpy (&bytes, block + 8 * half, 8);
+          const std::uint64_t x = bytes ^ pattern;
+          const std::uint64_t eq = ~(((x & LOW) + LOW) | x) & ~LOW;
+          mask |= static_cast<std::uint32_t> (((eq >> 7) * GATHER) >> 56)
+                  << (8 * half);
+        }
+      return mask;
+    }
+  std::uint32_t mask = 0;
+  for (int k = 0; k < 16; ++k)
+    mask |= std::uint32_t {block[k] == c} << k;
+  return mask;
+#endif
+}
+
+/// Returns the first character in `[begin, end)` that is one of `Set`, or
+/// `end`.  Scans 16 bytes at a time using `match_block`.
+template <char... Set>
+static inline const char *
+find_any (const char *begin, const char *end)
+{
+  for (; end - begin >= 16; begin += 16)
+    if (const std::uint32_t mask = (match_block (begin, Set) | ...))
+      return begin + std::countr_zero (mask);
+  for (; begin != end; ++begin)
+    if (((*begin == Set) || ...))
+      return begin;
+  return end;
+}
+
+/// Copies `[begin, end)` to `out` for `unquote_argument`, which writes behind
+/// the position it reads from so the ranges may overlap.
+static inline char *
+move_run (const char *begin, const char *end, char *out)
+{
+  const auto size = static_cast<std::size_t> (end - begin);
+  if (out != begin)
+    std::memmove (out, begin, size);
+  return out + size;
+}
+
+/// Stands in for the output of `unquote_argument` to measure an argument
+/// without writing it.
+struct Unquoted_Size
+{
+  std::size_t size = 0;
+};
+
+static inline Unquoted_Size
+move_run (const char *begin, const char *end, Unquoted_Size out)
+{ return {out.size + static_cast<std::size_t> (end - begin)}; }
+
+static inline void
+put (char *&out, char c)
+{ *out++ = c; }
+
+static inline void
+put (Unquoted_Size &out, char)
+{ ++out.size; }
+
+/// Whether `c` separates arguments in a command string or, if
+/// `response_file` is set, in a response file, which may also separate them
+/// with carriage returns or null characters.
+template <bool response_file>
+static inline bool
+is_blank (char c)
+{
+  if constexpr (response_file)
+    if (c == '\r' || c == '\0')
+      return true;
+  return c == ' ' || c == '\t' || c == '\n';
+}
+
+/// Skips the blanks at `in`.  A backslash-newline removed before an argument
+/// starts does not start one, like in a shell.
+template <bool response_file>
+static inline const char *
+skip_blanks (const char *in, const char *end)
+{
+  for (; in != end; ++in)
+    if (*in == '\\' && end - in >= 2 && in[1] == '\n')
+      ++in;
+    else if (!is_blank<response_file> (*in))
+      break;
+  return in;
+}
+
+/// Unquotes the argument starting at `in` up to the next unquoted blank,
+/// following the rules described at `flag::tokenize`.  The argument is
+/// written to `out`, which may be at or before `in`, or only counted if it
+/// is an `Unquoted_Size`.  Returns false if a quote is not closed.
+template <bool response_file, class Out>
+static inline bool
+unquote_argument (const char *&in, const char *end, Out &out)
+{
+  while (in != end && !is_blank<response_file> (*in))
+    {
+      const char *special;
+      if constexpr (response_file)
+        special = find_any<' ', '\t', '\n', '\r', '\0', '\'', '"', '\\'> (in,
+                                                                        end);
+      else
+        special = find_any<' ', '\t', '\n', '\'', '"', '\\'> (in, end);
+      out = move_run (in, special, out);
+      in = special;
+      if (in == end || is_blank<response_file> (*in))
+        break;
+      switch (*in++)
+        {
+          case '\\':
+            if (in == end)
+              put (out, '\\');
+            else if (*in++ != '\n')
+              put (out, in[-1]);
+            break;
+          case '\'':
+            special = static_cast<const char *> (
+              std::memchr (in, '\'', static_cast<std::size_t> (end - in)));
+            if (!special)
+              return false;
+            out = move_run (in, special, out);
+            in = special + 1;
+            break;
+          default:
+            for (;;)
+              {
+                special = find_any<'"', '\\'> (in, end);
+                out = move_run (in, special, out);
+                in = special;
+                if (in == end)
+                  return false;
+                if (*in++ == '"')
+                  break;
+                if (in != end && *in == '\n')
+                  ++in;
+                else if (in != end && (*in == '$' || *in == '`'
+                                       || *in == '"' || *in == '\\'))
+                  put (out, *in++);
+                else
+                  put (out, '\\');
+              }
+        }
+    }
+  return true;
+}
+
+/// Splits the contents of a response file into arguments one at a time.
+/// Arguments without quotes refer into the contents, the others are unquoted
+/// into a buffer given by the caller.
+class Response_Tokens
+{
+  const char *in_;
+  const char *end_;
+  bool unterminated_ = false;
+
+public:
+  explicit Response_Tokens (std::span<const char> contents)
+  : in_ (contents.data ()), end_ (contents.data () + contents.size ())
+  {}
+
+  /// Stores the next argument in `token`, returns false at the end of the
+  /// file or at a quote which is not closed.  `buffer` holds the argument if
+  /// it has to be unquoted, it is only resized if it is too small.
+  bool next (std::string_view &token, std::pmr::vector<char> &buffer)
+  {
+    in_ = skip_blanks<true> (in_, end_);
+    if (in_ == end_)
+      return false;
+    const char *const begin = in_;
+    const char *in = begin;
+    const char *special = find_any<' ', '\t', '\n', '\r', '\0', '\'', '"',
+                                   '\\'> (in, end_);
+    if (special == end_ || is_blank<true> (*special))
+      {
+        in_ = special;
+        token = {begin, static_cast<std::size_t> (special - begin)};
+        return true;
+      }
+    Unquoted_Size size;
+    if (!unquote_argument<true> (in, end_, size))
+      {
+        unterminated_ = true;
+        in_ = end_;
+        return false;
+      }
+    if (buffer.size () < size.size)
+      buffer.resize (size.size);
+    char *out = buffer.data ();
+    in = begin;
+    unquote_argument<true> (in, end_, out);
+    in_ = in;
+    token = {buffer.data (), size.size};
+    return true;
+  }
+
+  bool unterminated () const
+  { return unterminated_; }
+};
+
+// https://en.wikipedia.org/wiki/Jaro%E2%80%93Winkler_distance#Jaro_similarity
+static double
+jaro_similarity (std::string_view a, std::string_view b)
+{
+  // Note: This byte-wise processing does work for UTF-8 text, however
+  //       the text may need to be closer in appearance than with ascii
+  //       as characters using multiple bytes are treated the same as multiple
+  //       characters and therefore get a higher similarity penalty if they are
+  //       not equal.
+
+  // Only the start of very long strings is compared, so `used` and the copy
+  // of B fit on the stack.
+  a = a.substr (0, MAX_SIMILARITY_LENGTH);
+  b = b.substr (0, MAX_SIMILARITY_LENGTH);
+
+  // Trivial cases
+  if (a.empty () && b.empty ())
+    return 1.0;
+  else if (a.empty () || b.empty ())
+    return 0.0;
+  else if (a.size () == 1 && b.size () == 1)
+    return a[0] == b[0] ? 1.0 : 0.0;
+
+  // Distance a character can have from a position and still be considered matching.
+  const auto match_range = std::max (a.size (), b.size ()) / 2 - 1;
+  // Keeps track of characters in B we have already matched, the extra word
+  // lets a 16-bit window be read at any position.
+  std::array<std::uint64_t, MAX_SIMILARITY_LENGTH / 64 + 1> used {};
+  // B padded so the match window can be compared 16 bytes at a time.
+  std::array<char, MAX_SIMILARITY_LENGTH + 16> padded_b {};
+  std::memcpy (padded_b.data (), b.data (), b.size ());
+  // Position of last character mached in B, used for order checking
+  auto b_pos = std::size_t {};
+
+  auto matches = 0.0;
+  auto transpositions = 0.0;
+
+  for (std::size_t i = 0; i < a.size (); ++i)
+    {
+      const auto c = a[i];
+      const auto lo = i > match_range ? i - match_range : 0;
+      const auto hi = std::min (i + match_range, b.size () - 1);
+      // Finds the first unused character equal to C in the window.
+      for (std::size_t start = lo; start <= hi; start += 16)
+        {
+          const std::size_t word = start / 64;
+          const std::size_t shift = start % 64;
+          std::uint64_t used_bits = used[word] >> shift;
+          if (shift > 48)
+            used_bits |= used[word + 1] << (64 - shift);
+          std::uint32_t candidates = (match_block (padded_b.data () + start, c)
+                                      & ~static_cast<std::uint32_t> (used_bits));
+          if (hi - start < 15)
+            candidates &= (std::uint32_t {1} << (hi - start + 1)) - 1;
+          if (candidates == 0)
+            continue;
+          const std::size_t j = start + std::countr_zero (candidates);
+          used[j / 64] |= std::uint64_t {1} << (j % 64);
+          ++matches;
+          if (j < b_pos)
+            ++transpositions;
+          b_pos = j;
+          break;
+        }
+    }
+
+  if (matches == 0.0)
+    return 0.0;
+  else
+    return 0.333 * ((matches / a.size ())
+                    + (matches / b.size ())
+                    + ((matches - transpositions) / matches));
+}
+
+// https://en.wikipedia.org/wiki/Jaro%E2%80%93Winkler_distance#Jaro%E2%80%93Winkler_similarity
+static inline double
+jaro_winkler_similarity (std::string_view a, std::string_view b)
+{
+  constexpr double SCALING_FACTOR = 0.1;
+  const auto sim_j = jaro_similarity (a, b);
+  const auto l = std::distance (
+    a.begin (),
+    std::mismatch (a.begin (), a.end (), b.begin (), b.end ()).first
+  );
+  const auto sim_w = sim_j - l * SCALING_FACTOR * (1.0 - sim_j);
+  return sim_w <= 1.0 ? sim_w : 1.0;
+}
+
+/// Maximum number of similar flags suggested for an unknown flag.
+inline constexpr std::size_t MAX_SUGGESTIONS = 8;
+
+/// Writes up to `out.size ()` (at most `MAX_SUGGESTIONS`) of the flags most
+/// similar to `flag` to `out`, ordered by decreasing similarity.  The flags
+/// of the registry and of the schema described by `static_flags` are
+/// considered.  Returns the number written.
+static inline std::size_t
+find_similar (const Registry &registry, const Static_Flags &static_flags,
+              std::string_view flag, std::span<std::string_view> out)
+{
+  const std::size_t k = std::min (out.size (), MAX_SUGGESTIONS);
+  std::array<double, MAX_SUGGESTIONS> scores;
+  std::size_t found = 0;
+  if (k == 0)
+    return 0;
+  const auto consider = [&] (std::string_view name) {
+    const auto sim = jaro_winkler_similarity (name, flag);
+    if (sim <= Length_Index::THRESHOLD
+        || (found == k && sim <= scores[k - 1]))
+      return;
+    std::size_t i = found < k ? found++ : k - 1;
+    for (; i > 0 && scores[i - 1] < sim; --i)
+      {
+        scores[i] = scores[i - 1];
+        out[i] = out[i - 1];
+      }
+    scores[i] = sim;
+    out[i] = name;
+  };
+  // Schema flags are looked up first, so they win ties.
+  const auto n = static_cast<double> (flag.size ());
+  for (const std::string_view name : static_flags.flags)
+    {
+      const auto length = static_cast<double> (name.size ());
+      if (length > n * Length_Index::MIN_LENGTH_RATIO
+          && length * Length_Index::MIN_LENGTH_RATIO < n)
+        consider (name);
+    }
+  for (const auto &entry : registry.lengths.candidates (flag.size ()))
+    consider (registry.options.name (entry.option));
+  return found;
+}
+
+static inline void
+look_for_similar (const Registry &registry, const Static_Flags &static_flags,
+                  std::string_view dash, std::string_view flag)
+{
+  std::array<std::string_view, MAX_SUGGESTIONS> similar;
+  const std::size_t found = find_similar (
+    registry, static_flags, flag,
+    std::span (similar).first (registry.suggestions));
+  for (std::size_t i = 0; i < found; ++i)
+    std::cerr << (i == 0 ? ", did you mean " : i + 1 == found ? " or " : ", ")
+              << dash << similar[i];
+  if (found)
+    std::cerr << '?';
+}
+
+static inline void
+complain (const Registry &registry, const Static_Flags &static_flags,
+          const char *program, Process_Result about, std::string_view flag,
+          std::string_view value, bool double_dash)
+{
+  std::cerr << program << ": ";
+  // Since we extract the flag name from the arg-element we need to add the
+  // correct number of dashes to the error message
+  std::string_view dash = double_dash ? "--" : "-";
+  switch (about)
+    {
+      break; case Process_Result::Ok: // To suppress warnings
+      break; case Process_Result::Help:
+      break; case Process_Result::Complete:
+      break; case Process_Result::Invalid_Option:
+        std::cerr << "unrecognized option ‘" << dash << flag << "’";
+        look_for_similar (registry, static_flags, dash, flag);
+      break; case Process_Result::Missing_Value:
+        std::cerr << "option ‘" << dash << flag <<  "’ requires an argument";
+      break; case Process_Result::Unexpected_Value:
+        std::cerr << "option ‘" << dash << flag
+                  << "’ doesn't allow an argument";
+      break; case Process_Result::Invalid_Value:
+        std::cerr << "invalid argument ‘" << value <<  "’ for ‘" << dash
+                  << flag << "’";
+      break; case Process_Result::Ambiguous_Option:
+        std::cerr << "option ‘" << dash << flag << "’ is ambiguous;"
+                  << " possibilities:";
+        for (const auto &entry : static_flags.with_prefix (flag))
+          std::cerr << " ‘" << dash << entry.name << "’";
+        for (const auto &entry : registry.prefixes.find (flag))
+          std::cerr << " ‘" << dash << entry.name << "’";
+      break; case Process_Result::Invalid_Response_File:
+        std::cerr << "cannot read response file ‘" << flag << "’: " << value;
+    }
+  std::cerr << std::endl;
+  if (!error_description.empty ())
+    std::cerr << error_description << std::endl;
+}
+
+/// Processes a single-character flag group in one pass: each codepoint is
+/// looked up in the short flag table and staged, the boolean flags are only
+/// set once the whole group is valid and the last flag was processed
+/// successfully.  Only the last flag in a group may take a value.
+/// Returns the last flag and the result of setting its value, or an empty
+/// flag and `Process_Result::Invalid_Option` if this is not a valid group.
+static std::pair<std::string_view, Process_Result>
+process_group(const Registry &registry, std::string_view flags,
+              std::string_view &value, int &argind, int argc, Arg_List argv)
+{
+  constexpr std::size_t STAGED = 32;
+  std::array<std::uint32_t, STAGED> staged;
+  std::size_t n_staged = 0;
+  std::uint32_t last = NO_OPTION;
+  std::string_view last_flag = {};
+  std::size_t begin = 0;
+  for (std::size_t i = 1; i <= flags.size(); ++i)
+    {
+      if (i < flags.size() && (flags[i] & 0xC0) == 0x80)
+        continue;
+      const auto single = flags.substr(begin, i - begin);
+      const auto option = registry.singles.find(single);
+      if (option == NO_OPTION)
+        return {{}, Process_Result::Invalid_Option};
+      if (i == flags.size())
+        {
+          last = option;
+          last_flag = single;
+        }
+      else if (registry.options.takes_value(option))
+        return {{}, Process_Result::Invalid_Option};
+      else if (n_staged < STAGED)
+        staged[n_staged++] = option;
+      begin = i;
+    }
+  const auto result = apply_option(registry, last, value, argind, argc, argv);
+  if (result != Process_Result::Ok)
+    return {last_flag, result};
+  // Everything before the last flag is a boolean flag so setting these can't
+  // fail.  Longer groups than we can stage are looked up again.
+  if (n_staged == STAGED)
+    for (std::size_t i = 0, start = 0; i < flags.size() - last_flag.size(); )
+      {
+        do
+          ++i;
+        while ((flags[i] & 0xC0) == 0x80);
+        parse_option(registry.options,
+                     registry.singles.find(flags.substr(start, i - start)),
+                     {}, true);
+        start = i;
+      }
+  else
+    for (std::size_t i = 0; i < n_staged; ++i)
+      parse_option(registry.options, staged[i], {}, true);
+  return {last_flag, Process_Result::Ok};
+}
+
+/// Callables accepted for the non-flag arguments by `parse`.
+template <class F>
+concept collector = (std::is_invocable_v<F &, const char *>
+                     || std::is_invocable_v<F &, const char *, int>);
+
+/// Collectors taking a `std::string_view`, which are needed for arguments
+/// that are not null-terminated.
+template <class F>
+concept view_collector = (std::is_invocable_v<F &, std::string_view>
+                          || std::is_invocable_v<F &, std::string_view, int>);
+
+/// Wraps a collector that copies its argument, like into a `std::string`,
+/// so arguments from response files need not be kept for it.
+template <class F>
+struct Copying_Collector
+{
+  F f;
+
+  template <class... Args>
+    requires std::is_invocable_v<F &, Args...>
+  void operator() (Args... args)
+  { f (args...); }
+};
+
+template <class F>
+constexpr bool is_copying_collector = false;
+
+template <class F>
+constexpr bool is_copying_collector<Copying_Collector<F>> = true;
+
+/// Passes a non-flag argument to `collect_arg`, along with its index if it
+/// accepts one.  Collectors taking a `const char *` are only used with
+/// null-terminated arguments.
+template <class Collect>
+static inline void
+collect (Collect &collect_arg, Arg_List argv, int i)
+{
+  if constexpr (std::is_invocable_v<Collect &, std::string_view, int>)
+    collect_arg (argv[i], i);
+  else if constexpr (view_collector<Collect>)
+    collect_arg (argv[i]);
+  else if constexpr (std::is_invocable_v<Collect &, const char *, int>)
+    collect_arg (argv.c_str (i), i);
+  else
+    collect_arg (argv.c_str (i));
+}
+
+/// Where and why parsing a command line stopped.
+struct Parse_Failure
+{
+  Process_Result result = Process_Result::Ok;
+  // Index of the argv-element containing the flag, or of the response file
+  // containing it.
+  int argind = 0;
+  // For `Process_Result::Invalid_Response_File` the path of the file and
+  // why it could not be read.
+  std::string_view flag = {};
+  std::string_view value = {};
+  // If the flag was a valid group whose last flag failed to take its value,
+  // that flag and its result.
+  std::string_view group_flag = {};
+  Process_Result group_result = Process_Result::Ok;
+  // On success, the first argv-element after the `--` terminator or, when
+  // stopping at the first non-flag argument, that argument; `argc` if flag
+  // parsing did not stop early.  For completion requests `argc`.
+  int rest = 0;
+  // Whether the flag was given with two dashes.
+  bool double_dash = false;
+};
+
+/// How parsing continues after an argument.
+enum class Step
+{
+  Next,
+  // Flag parsing stopped, the remaining arguments are collected.
+  Stop,
+  Fail
+};
+
+/// Maximum nesting of response files.
+inline constexpr std::size_t MAX_RESPONSE_DEPTH = 32;
+
+/// The state of `parse_args`, which parses one argument at a time from argv
+/// or from a response file.
+template <class Collect, class Process>
+struct Argument_Parser
+{
+  const Registry &registry;
+  // The flags of the schema `process` looks up first, if any.
+  const Static_Flags &static_flags;
+  Collect &collect_arg;
+  Process &process;
+  const bool has_usage;
+  // Whether `@file` arguments are expanded.
+  const bool expand;
+  // Index of the argv-element being parsed, or of the response file the
+  // argument is read from.
+  int top = 0;
+  Parse_Failure failure = {};
+  // The response files currently being read.
+  std::array<File_Id, MAX_RESPONSE_DEPTH> open_files = {};
+  std::size_t depth = 0;
+
+  /// Passes argument `i` to `collect_arg`.  Arguments from response files
+  /// are released after the file is parsed, collectors get a copy unless
+  /// they copy the argument themselves.
+  void collect_at (Arg_List argv, int i)
+  {
+    if (depth == 0)
+      {
+        collect (collect_arg, argv, i);
+        return;
+      }
+    const std::string_view arg = argv[i];
+    const auto pass = [this, &arg] (const char *c_string) {
+      const std::string_view view (c_string, arg.size ());
+      if constexpr (std::is_invocable_v<Collect &, std::string_view, int>)
+        collect_arg (view, top);
+      else if constexpr (view_collector<Collect>)
+        collect_arg (view);
+      else if constexpr (std::is_invocable_v<Collect &, const char *, int>)
+        collect_arg (c_string, top);
+      else
+        collect_arg (c_string);
+      return true;
+    };
+    if constexpr (is_copying_collector<std::remove_cv_t<Collect>>)
+      with_c_string (arg, false, pass);
+    else
+      pass (registry.response_strings.intern (arg));
+  }
+
+  /// Copies the strings in `failure`, which may refer into the response
+  /// file that is released when the failure is returned.  There is one copy
+  /// per thread, replaced by the next failure in a response file.
+  void keep_failure ()
+  {
+    static thread_local std::string kept;
+    std::string copy;
+    copy.reserve (failure.flag.size () + failure.value.size ()
+                  + failure.group_flag.size ());
+    copy.append (failure.flag).append (failure.value)
+      .append (failure.group_flag);
+    kept = std::move (copy);
+    const std::string_view strings = kept;
+    failure.flag = strings.substr (0, failure.flag.size ());
+    failure.value = strings.substr (failure.flag.size (),
+                                    failure.value.size ());
+    failure.group_flag = strings.substr (failure.flag.size ()
+                                         + failure.value.size ());
+  }
+
+  /// Parses argument `i`, advancing `i` past the values it takes.
+  Step parse (int &i, int argc, Arg_List argv)
+  {
+    using namespace std::literals;
+
+    if (argv.front (i) == '-')
+      {
+        const std::string_view element = argv[i];
+        const std::string_view arg
+          = element.substr (1 + element.starts_with ("--"));
+        if (arg.empty ())
+          {
+            ++i;
+            return Step::Stop;
+          }
+        const int flag_ind = depth ? top : i;
+        if (has_usage && arg == "help")
+          {
+            failure = {Process_Result::Help, flag_ind, arg};
+            return Step::Fail;
+          }
+        // Only the default usage can search the help, for a custom usage
+        // function `-help=PATTERN` stays an unknown flag.
+        if (registry.use_default_usage && arg.starts_with ("help="))
+          {
+            failure = {Process_Result::Help, flag_ind, arg.substr (0, 4),
+                       arg.substr (5)};
+            return Step::Fail;
+          }
+        const std::size_t eq_pos = arg.find ('=');
+        const std::string_view flag = arg.substr (0, eq_pos);
+        // If this is empty now it will recieve the value of the following
+        // argv-element in `detail::process_flag`.
+        std::string_view value = (eq_pos == std::string_view::npos
+                                  ? ""sv
+                                  : arg.substr (eq_pos + 1));
+        const auto result = process (flag, value, i, argc, argv);
+        if (result == Process_Result::Ok)
+          return Step::Next;
+        failure = {result, flag_ind, flag, value};
+        failure.double_dash = element.starts_with ("--");
+        // A flag that exists by itself is never treated as a group.
+        if (result == Process_Result::Invalid_Option
+            && registry.group_singles)
+          {
+            const auto [f, r] = process_group(registry, flag, value, i, argc,
+                                              argv);
+            if (r == Process_Result::Ok)
+              return Step::Next;
+            if (!f.empty ())
+              {
+                failure.group_flag = f;
+                failure.group_result = r;
+                failure.value = value;
+                return Step::Fail;
+              }
+          }
+        // Groups take precedence over abbreviations since they consist of
+        // flag names only.
+        if (result == Process_Result::Invalid_Option
+            && registry.abbreviations)
+          {
+            const auto [f, r] = process_abbreviation (registry, static_flags,
+                                                      process, flag, value, i,
+                                                      argc, argv);
+            if (r == Process_Result::Ok)
+              return Step::Next;
+            failure.result = r;
+            failure.flag = f;
+            failure.value = value;
+          }
+        return Step::Fail;
+      }
+    if (expand && argv.front (i) == '@' && argv[i].size () > 1)
+      return read_response_file (i, argv[i].substr (1));
+    if (registry.stop_at_args)
+      return Step::Stop;
+    collect_at (argv, i);
+    return Step::Next;
+  }
+
+  /// Parses the arguments in the response file at `path`, given by argument
+  /// `i`.  They are read lazily through a window of two arguments, the
+  /// current one and the value it may take, so only the longest quoted
+  /// argument is held besides the file, which is released at the end.
+  Step read_response_file (int &i, std::string_view path)
+  {
+    const auto fail = [this, &i, path] (const char *reason) {
+      failure = {Process_Result::Invalid_Response_File, depth ? top : i,
+                 path, reason};
+      return Step::Fail;
+    };
+    if (depth == MAX_RESPONSE_DEPTH)
+      return fail ("nested too deeply");
+    std::pmr::memory_resource *resource
+      = registry.options.names.get_allocator ().resource ();
+    Response_File file (resource);
+    File_Id id;
+    if (const char *error = file.load (std::string (path), id))
+      return fail (error);
+    const auto open_end = open_files.begin () + depth;
+    if (std::find (open_files.begin (), open_end, id) != open_end)
+      return fail ("it includes itself");
+    open_files[depth++] = id;
+    Response_Tokens tokens (file.contents ());
+    std::string_view window[2];
+    // The unquoted arguments in `window`, swapped along with them.
+    std::pmr::vector<char> buffers[2] = {std::pmr::vector<char> (resource),
+                                         std::pmr::vector<char> (resource)};
+    const Arg_List args (window, false, &registry.response_strings);
+    int count = 0;
+    // Fills the window.  A quote that is not closed is reported before the
+    // arguments preceding it are parsed, as a flag there would otherwise
+    // miss its value.
+    const auto fill = [&tokens, &window, &buffers, &count] {
+      while (count < 2 && tokens.next (window[count], buffers[count]))
+        ++count;
+      return !tokens.unterminated ();
+    };
+    if (!fill ())
+      return fail ("unterminated quote");
+    Step step = Step::Next;
+    while (count != 0)
+      {
+        int k = 0;
+        step = parse (k, count, args);
+        if (step == Step::Fail)
+          {
+            keep_failure ();
+            return step;
+          }
+        if (step == Step::Stop)
+          {
+            // Collect the rest of the file, including the argument at which
+            // flag parsing stopped.
+            for (; k < count; ++k)
+              collect_at (args, k);
+            std::string_view token;
+            while (tokens.next (token, buffers[0]))
+              collect_at (&token, 0);
+            break;
+          }
+        if (k == 0 && count == 2)
+          {
+            window[0] = window[1];
+            std::swap (buffers[0], buffers[1]);
+          }
+        count = (k == 0 && count == 2);
+        if (!fill ())
+          return fail ("unterminated quote");
+      }
+    --depth;
+    // Only the rest of the file collected after flag parsing stopped can
+    // still end in an open quote.
+    if (tokens.unterminated ())
+      return fail ("unterminated quote");
+    if (step == Step::Stop)
+      ++i;
+    return step;
+  }
+};
+
+/// The argument loop shared by all `parse` overloads.  `process` is called
+/// like `process_flag` for every flag; single-character groups are only
+/// looked up in the runtime registry.
+/// `static_flags` describes the schema `process` looks up first, if any.
+/// This does not print anything or exit, the first failure is returned.
+/// If `collect_rest` is false the arguments following the point where flag
+/// parsing stopped are not passed to `collect_arg`, the caller gets their
+/// index through `Parse_Failure::rest` instead.  Response files are only
+/// expanded otherwise, since their arguments have no index in argv.
+template <bool collect_rest = true, class Collect, class Process>
+static inline Parse_Failure
+parse_args (const Registry &registry, int argc, Arg_List argv,
+            Collect &&collect_arg, Process &&process,
+            const Static_Flags &static_flags = {})
+{
+  if (registry.completion && argc >= 2
+      && (argv[1] == "__complete" || argv[1] == "__completion"))
+    return {Process_Result::Complete, 1, argv[1], {}, {}, Process_Result::Ok,
+            argc};
+
+  Argument_Parser<std::remove_reference_t<Collect>,
+                  std::remove_reference_t<Process>> parser {
+    registry, static_flags, collect_arg, process,
+    registry.use_default_usage || bool (registry.usage),
+    collect_rest && registry.expand_response_files};
+  int i;
+  for (i = 1; i < argc; ++i)
+    {
+      parser.top = i;
+      const Step step = parser.parse (i, argc, argv);
+      if (step == Step::Fail)
+        return parser.failure;
+      if (step == Step::Stop)
+        break;
+    }
+
+  Parse_Failure success = {};
+  success.rest = i;
+  // Collect remaining arguments if we broke out of the above loop
+  if constexpr (collect_rest)
+    for (; i < argc; ++i)
+      collect (collect_arg, argv, i);
+  return success;
+}
+
+/// Prints the usage or error message for a failed parse and exits.
+[[noreturn]] static inline void
+exit_with (const Registry &registry, Arg_List argv,
+           const Parse_Failure &failure, const Static_Flags &static_flags = {})
+{
+#if defined (_WIN32) && defined (FLAG_SHORTEN_WINDOWS_PROGRAM_PATH)
+  // Powershell always gives the full path of the executable so
+  // we use this option to allow for it to be shortened to just the
+  // name of the executable (still including the .exe)
+  const auto program = std::filesystem::path (argv[0]).filename ().string ();
+  const char *const argv0 = program.c_str ();
+#else
+  // The usage function takes the program name as a C string.
+  const std::string program (argv.terminated () ? std::string_view ()
+                                                : argv[0]);
+  const char *const argv0 = (argv.terminated () ? argv.c_str (0)
+                                                : program.c_str ());
+#endif
+
+  if (failure.result == Process_Result::Help)
+    {
+      print_usage (registry, argv0, failure.value, static_flags);
+      std::exit (0);
+    }
+  if (failure.result == Process_Result::Complete)
+    {
+      if (complete (registry, failure.rest, argv, static_flags))
+        std::exit (0);
+      std::cerr << argv0 << ": unsupported shell, expected bash, zsh or fish"
+                << std::endl;
+      std::exit (1);
+    }
+  const bool double_dash = failure.double_dash;
+  // Last flag in the group had an error with its value,
+  // in this case we just print the error messages for both
+  // this flag and the original flag.
+  if (failure.group_result != Process_Result::Ok)
+    complain (registry, static_flags, argv0, failure.group_result,
+              failure.group_flag, failure.value, double_dash);
+  complain (registry, static_flags, argv0, failure.result, failure.flag,
+            failure.value, double_dash);
+  if (registry.use_default_usage || registry.usage)
+    std::cerr << "Try '" << argv0 << " -help' for more information.\n";
+  std::exit (1);
+}
+
+static inline Parse_Result
+to_result (const Parse_Failure &failure)
+{
+  if (failure.result == Process_Result::Ok)
+    return {};
+  if (failure.group_result != Process_Result::Ok)
+    return Parse_Error {failure.group_result, failure.group_flag,
+                        failure.value, failure.argind};
+  return Parse_Error {failure.result, failure.flag, failure.value,
+                      failure.argind};
+}
+
+/// Hands out the indices `[0, size)` to a fixed number of workers.  Each
+/// worker starts on its own contiguous range and steals chunks from the
+/// ranges of the others once that is exhausted.
+class Work_Ranges
+{
+  static constexpr std::size_t CHUNK = 64;
+
+  struct alignas (64) Range
+  {
+    std::atomic<std::size_t> next;
+    std::size_t end;
+  };
+
+  std::unique_ptr<Range[]> ranges_;
+  std::size_t workers_;
+
+public:
+  Work_Ranges (std::size_t size, std::size_t workers)
+  : ranges_ (new Range[workers]), workers_ (workers)
+  {
+    for (std::size_t w = 0; w < workers; ++w)
+      {
+        ranges_[w].next = size * w / workers;
+        ranges_[w].end = size * (w + 1) / workers;
+      }
+  }
+
+  /// Claims the next chunk for the given worker, returns an empty range once
+  /// all work is done.
+  std::pair<std::size_t, std::size_t> claim (std::size_t worker)
+  {
+    for (std::size_t k = 0; k < workers_; ++k)
+      {
+        Range &range = ranges_[(worker + k) % workers_];
+        if (range.next.load (std::memory_order_relaxed) >= range.end)
+          continue;
+        const std::size_t begin = range.next.fetch_add (CHUNK);
+        if (begin < range.end)
+          return {begin, std::min (begin + CHUNK, range.end)};
+      }
+    return {0, 0};
+  }
+};
+
+/// Calls `parse (i)` for the indices `[0, size)`, spread over `threads`
+/// threads (the hardware concurrency if 0) using `Work_Ranges`.
+template <class Parse>
+static inline void
+run_batch (std::size_t size, unsigned threads, Parse &&parse)
+{
+  if (threads == 0)
+    threads = std::max (std::thread::hardware_concurrency (), 1u);
+  threads = static_cast<unsigned> (std::min<std::size_t> (threads,
+                                                          size / 64 + 1));
+  Work_Ranges ranges (size, threads);
+  auto work = [&] (std::size_t worker) {
+    for (auto [begin, end] = ranges.claim (worker); begin != end;
+         std::tie (begin, end) = ranges.claim (worker))
+      for (std::size_t i = begin; i < end; ++i)
+        parse (i);
+  };
+  std::vector<std::thread> pool;
+  pool.reserve (threads - 1);
+  for (unsigned worker = 1; worker < threads; ++worker)
+    pool.emplace_back (work, worker);
+  work (0);
+  for (auto &thread : pool)
+    thread.join ();
+}
+
+/// The arguments of a `Null_Separated` command line, found with `memchr` and
+/// referring into its buffer.  Up to `INLINE` arguments are stored without
+/// allocating.
+class Split_Command_Line
+{
+  static constexpr std::size_t INLINE = 64;
+
+  alignas (std::string_view) std::byte initial_[INLINE
+                                                * sizeof (std::string_view)];
+  std::pmr::monotonic_buffer_resource resource_;
+  std::pmr::vector<std::string_view> args_;
+  // Whether the last argument is followed by a null character as well.
+  bool terminated_;
+
+public:
+  explicit Split_Command_Line (std::string_view buffer)
+  : resource_ (initial_, sizeof (initial_)), args_ (&resource_),
+    terminated_ (buffer.empty () || buffer.back () == '\0')
+  {
+    args_.reserve (INLINE);
+    const char *begin = buffer.data ();
+    const char *const end = begin + buffer.size ();
+    while (begin != end)
+      {
+        const auto *nul = static_cast<const char *> (
+          std::memchr (begin, '\0', static_cast<std::size_t> (end - begin)));
+        const char *const stop = nul ? nul : end;
+        args_.emplace_back (begin, static_cast<std::size_t> (stop - begin));
+        begin = nul ? nul + 1 : end;
+      }
+  }
+
+  Split_Command_Line (const Split_Command_Line &) = delete;
+  Split_Command_Line & operator= (const Split_Command_Line &) = delete;
+
+  int argc () const
+  { return static_cast<int> (args_.size ()); }
+
+  Arg_List argv () const
+  { return {args_.data (), terminated_}; }
+};
+
+/// Sinks whose `collect_arg` takes a `std::string_view`.
+template <class Sink>
+concept view_sink = requires (Sink &sink, std::string_view arg) {
+  sink.collect_arg (arg);
+};
+
+} // namespace detail
+
+/// A flag in a `Schema`, e.g. `flag::Opt<"threads", int, "# of threads">`,
+/// followed by any number of aliases.
+template <detail::Fixed_String Name, class T, detail::Fixed_String Help = "",
+          detail::Fixed_String... Aliases>
+struct Opt
+{
+  static_assert (types::Value_Type<T>::is_supported, "Unsupported type");
+  using value_type = T;
+  static constexpr std::string_view name = Name.view ();
+  static constexpr std::string_view help_text = Help.view ();
+  static constexpr std::array<std::string_view, sizeof... (Aliases)> aliases {
+    Aliases.view ()...
+  };
+};
+
+/// A set of flags known at compile time.  The values are stored in the schema
+/// itself, flags are found through a compile-time perfect hash and converted
+/// without virtual calls or heap allocations.  Boolean flags are set to the
+/// opposite of their value before parsing, like those added at runtime.
+///
+/// ```
+/// flag::Schema<flag::Opt<"threads", int>, flag::Opt<"v", bool>> schema;
+/// schema.get<"threads"> () = 4;
+/// flag::parse (argc, argv, schema, collect_arg);
+/// ```
+template <class... Opts>
+class Schema
+{
+  friend class Flag_Set;
+
+  static constexpr std::size_t size_ = sizeof... (Opts);
+  static constexpr std::size_t names_size_
+    = (size_ + ... + Opts::aliases.size ());
+
+  // The names of all flags followed by all aliases, and the index of the flag
+  // each of them belongs to (plus `size_` for names that are not found).
+  static constexpr auto names_ = [] {
+    std::array<std::string_view, names_size_> names = {};
+    std::size_t k = 0;
+    ((names[k++] = Opts::name), ...);
+    ([&] {
+      for (const auto alias : Opts::aliases)
+        names[k++] = alias;
+    } (), ...);
+    return names;
+  } ();
+  static constexpr auto owners_ = [] {
+    std::array<std::size_t, names_size_ + 1> owners = {};
+    std::size_t k = 0;
+    [[maybe_unused]] std::size_t i = 0;
+    for (; k < size_; ++k)
+      owners[k] = k;
+    ([&] {
+      for (std::size_t j = 0; j < Opts::aliases.size (); ++j)
+        owners[k++] = i;
+      ++i;
+    } (), ...);
+    owners[k] = size_;
+    return owners;
+  } ();
+  static constexpr detail::Perfect_Hash<names_size_> hash_ {names_};
+  static constexpr std::array<std::string_view, size_> help_texts_ {
+    Opts::help_text...
+  };
+  static constexpr std::array<detail::Static_Value, size_> values_info_ {
+    detail::static_value<typename Opts::value_type> ()...
+  };
+  static constexpr auto sorted_names_ = [] {
+    std::array<detail::Static_Name, names_size_> sorted = {};
+    for (std::size_t k = 0; k < names_size_; ++k)
+      sorted[k] = {names_[k], owners_[k]};
+    std::sort (sorted.begin (), sorted.end (),
+               [] (const detail::Static_Name &a, const detail::Static_Name &b) {
+                 return a.name < b.name;
+               });
+    return sorted;
+  } ();
+
+  /// Writes the entry of `Opt` in the format of the default usage function.
+  template <class Opt>
+  static constexpr void render_option (detail::Static_Writer &out,
+                                       bool show_types)
+  {
+    out.put ("    -");
+    out.put (Opt::name);
+    for (const auto alias : Opt::aliases)
+      {
+        out.put (", -");
+        out.put (alias);
+      }
+    if (show_types && !std::is_same_v<typename Opt::value_type, bool>)
+      {
+        out.put (" \x1b[2m");
+        constexpr const char *value_name
+          = types::Value_Type<typename Opt::value_type>::value_name;
+        if constexpr (value_name != nullptr)
+          out.put (value_name);
+        else
+          for (const char ch : Opt::name)
+            out.put (ch >= 'a' && ch <= 'z' ? ch - 'a' + 'A' : ch);
+        out.put ("\x1b[0m");
+      }
+    out.put ('\n');
+    std::string_view help = Opt::help_text;
+    while (!help.empty ())
+      {
+        const std::size_t eol = help.find ('\n');
+        out.put ("        ");
+        out.put (help.substr (0, eol));
+        out.put ('\n');
+        help.remove_prefix (eol == help.npos ? help.size () : eol + 1);
+      }
+  }
+
+  /// Renders the entries of all flags, recording where each ends.
+  static constexpr std::size_t render (char *data, std::size_t *ends,
+                                       [[maybe_unused]] bool show_types)
+  {
+    detail::Static_Writer out {data};
+    std::size_t i = 0;
+    ((render_option<Opts> (out, show_types),
+      ends ? (ends[i++] = out.size) : 0), ...);
+    return out.size;
+  }
+
+  template <bool show_types>
+  struct Usage
+  {
+    static constexpr std::size_t size = render (nullptr, nullptr, show_types);
+    static constexpr auto data_and_offsets = [] {
+      std::pair<std::array<char, size>, std::array<std::size_t, size_ + 1>>
+        result = {};
+      render (result.first.data (), result.second.data () + 1, show_types);
+      return result;
+    } ();
+  };
+
+  static constexpr detail::Static_Flags static_flags (bool show_types)
+  {
+    const auto make = [] (const auto &usage) -> detail::Static_Flags {
+      return {{usage.first.data (), usage.first.size ()}, usage.second,
+              {names_.data (), size_}, help_texts_, values_info_,
+              sorted_names_};
+    };
+    return (show_types ? make (Usage<true>::data_and_offsets)
+                       : make (Usage<false>::data_and_offsets));
+  }
+
+  std::tuple<typename Opts::value_type...> values_ = {};
+  // The values of the boolean flags when parsing started, they are set to the
+  // opposite like boolean flags added to a `Flag_Set`.
+  std::array<bool, size_> bool_defaults_ = {};
+
+  /// Records the values of the boolean flags, called by `Flag_Set` before
+  /// parsing.
+  void begin_parse ()
+  { record_bool_defaults (std::make_index_sequence<size_> {}); }
+
+  template <std::size_t... I>
+  void record_bool_defaults (std::index_sequence<I...>)
+  { (record_bool_default<I> (), ...); }
+
+  template <std::size_t I>
+  void record_bool_default ()
+  {
+    using T = std::tuple_element_t<I, decltype (values_)>;
+    if constexpr (std::is_same_v<T, bool>)
+      bool_defaults_[I] = std::get<I> (values_);
+  }
+
+  template <std::size_t I>
+  Process_Result set (std::string_view &value, int &argind, int argc,
+                      detail::Arg_List argv)
+  {
+    using T = std::tuple_element_t<I, decltype (values_)>;
+    if constexpr (std::is_same_v<T, bool>)
+      {
+        if (!value.empty ())
+          return Process_Result::Unexpected_Value;
+        std::get<I> (values_) = !bool_defaults_[I];
+      }
+    else
+      {
+        if (!detail::fetch_value (value, argind, argc, argv))
+          return Process_Result::Missing_Value;
+        if (!detail::convert_arg (value, argv.terminated (),
+                                  &std::get<I> (values_), argv.store ()))
+          return Process_Result::Invalid_Value;
+      }
+    return Process_Result::Ok;
+  }
+
+  template <std::size_t... I>
+  Process_Result dispatch (std::size_t index, std::string_view &value,
+                           int &argind, [[maybe_unused]] int argc,
+                           [[maybe_unused]] detail::Arg_List argv,
+                           std::index_sequence<I...>)
+  {
+    auto result = Process_Result::Invalid_Option;
+    (void) ((index == I && (result = set<I> (value, argind, argc, argv), true))
+            || ...);
+    return result;
+  }
+
+  template <detail::Fixed_String Name, std::size_t... I>
+  static constexpr std::size_t index_of (std::index_sequence<I...>)
+  {
+    std::size_t index = size_;
+    ((Opts::name == Name.view () ? (index = I) : 0), ...);
+    return index;
+  }
+
+public:
+  template <detail::Fixed_String Name>
+  auto & get ()
+  {
+    constexpr std::size_t index
+      = index_of<Name> (std::make_index_sequence<size_> {});
+    static_assert (index < size_, "No such flag in schema");
+    return std::get<index> (values_);
+  }
+
+  /// Like `detail::process_flag` but for the flags of this schema.
+  Process_Result process_flag (std::string_view flag, std::string_view &value,
+                               int &argind, int argc, detail::Arg_List argv)
+  {
+    return dispatch (owners_[hash_.find (flag)], value, argind, argc, argv,
+                     std::make_index_sequence<size_> {});
+  }
+
+  /// The entries of the flags of this schema in the default usage function,
+  /// rendered at compile time.
+  static constexpr std::string_view usage (bool show_types = true)
+  { return static_flags (show_types).text; }
+};
+
+/// A set of flags together with their aliases and settings.
+/// The free functions in this namespace operate on `flag::default_set ()`.
+///
+/// Once a flag set is frozen (explicitly or by the first `parse`) it is not
+/// modified by parsing, so the same set may be used to parse from many
+/// threads at once, as long as the flags of concurrent parses do not write
+/// to the same values.
+class Flag_Set
+{
+  detail::Registry registry_;
+  mutable std::atomic<bool> frozen_ = false;
+  mutable std::mutex freeze_mutex_;
+
+  template <class Collect, class Process>
+  detail::Parse_Failure parse_with (int argc, detail::Arg_List argv,
+                                    Collect &&collect_arg, Process &&process,
+                                    const detail::Static_Flags &static_flags
+                                      = {}) const
+  {
+    freeze ();
+    return detail::parse_args (registry_, argc, argv, collect_arg, process,
+                               static_flags);
+  }
+
+  /// The flags of `sink` if it is a `Schema`.
+  template <class Sink>
+  detail::Static_Flags static_flags (const Sink &) const
+  {
+    if constexpr (requires { Sink::static_flags (true); })
+      return Sink::static_flags (registry_.help_show_types);
+    else
+      return {};
+  }
+
+  auto registry_process () const
+  {
+    return [this] (std::string_view flag, std::string_view &value,
+                   int &argind, int argc, detail::Arg_List argv) {
+      return detail::process_flag (registry_, flag, value, argind, argc,
+                                   argv);
+    };
+  }
+
+  template <class Sink>
+  auto sink_process (Sink &sink) const
+  {
+    if constexpr (requires { sink.begin_parse (); })
+      sink.begin_parse ();
+    return [this, &sink] (std::string_view flag, std::string_view &value,
+                          int &argind, int argc, detail::Arg_List argv) {
+      const auto result = sink.process_flag (flag, value, argind, argc, argv);
+      if (result != Process_Result::Invalid_Option)
+        return result;
+      return detail::process_flag (registry_, flag, value, argind, argc,
+                                   argv);
+    };
+  }
+
+  /// Passes the non-flag arguments to `sink.collect_arg`, as views if it
+  /// takes them.
+  template <class Sink>
+  static auto sink_collect (Sink &sink)
+  {
+    if constexpr (detail::view_sink<Sink>)
+      return [&sink] (std::string_view arg) { sink.collect_arg (arg); };
+    else
+      return [&sink] (const char *arg) { sink.collect_arg (arg); };
+  }
+
+  void exit_on_failure (detail::Arg_List argv,
+                        const detail::Parse_Failure &failure,
+                        const detail::Static_Flags &static_flags = {}) const
+  {
+    if (failure.result != Process_Result::Ok)
+      detail::exit_with (registry_, argv, failure, static_flags);
+  }
+
+public:
+  /// All memory of the set is allocated from the given resource, apart from
+  /// what callbacks and the usage function allocate themselves.
+  explicit Flag_Set (std::pmr::memory_resource *resource
+                     = std::pmr::get_default_resource ())
+  : registry_ (resource)
+  {}
+
+  Flag_Set (const Flag_Set &) = delete;
+  Flag_Set & operator= (const Flag_Set &) = delete;
+
+  std::pmr::memory_resource * resource () const
+  { return registry_.aliases.get_allocator ().resource (); }
+
+  template <class T>
+    requires (!detail::callback<T>)
+  void add (T &value, std::string_view flag, std::string_view help_text = "")
+  {
+    static_assert (types::Value_Type<T>::is_supported, "Unsupported type");
+    if (flag.empty ())
+      throw std::invalid_argument ("Empty flag");
+    constexpr auto kind = detail::kind_of<T> ();
+    auto &options = registry_.options;
+    if constexpr (kind == detail::Option_Kind::Bool)
+      options.push_back (flag, help_text, kind, &value, !value);
+    else if constexpr (kind == detail::Option_Kind::Custom)
+      {
+        const auto index = static_cast<std::uint32_t> (options.custom.size ());
+        options.custom.push_back (detail::make_option (resource (), &value));
+        options.push_back (flag, help_text, kind, nullptr, index);
+      }
+    else
+      options.push_back (flag, help_text, kind, &value, 0);
+    frozen_ = false;
+  }
+
+  /// Adds a flag calling `func` with its value, any callable taking a
+  /// `std::string_view` (see `Option_Callable`) or a `const char *` and
+  /// returning `bool` is stored without a `std::function`.  The value may
+  /// only be valid during the call.
+  template <class F>
+    requires detail::callback<F>
+  void add (F &&func, std::string_view flag, std::string_view help_text = "")
+  {
+    if (flag.empty ())
+      throw std::invalid_argument ("Empty flag");
+    auto &options = registry_.options;
+    const auto index = static_cast<std::uint32_t> (options.callables.size ());
+    options.callables.emplace_back (
+      detail::adapt_callback (std::forward<F> (func)), resource ());
+    options.push_back (flag, help_text, detail::Option_Kind::Callable, nullptr,
+                       index);
+    frozen_ = false;
+  }
+
+  /// Sets a custom usage function, any callable taking the program name (see
+  /// `Help_Function`).
+  template <class F>
+    requires std::is_invocable_v<F &, const char *>
+  void add_help (F &&usage)
+  {
+    registry_.usage = {std::forward<F> (usage), resource ()};
+    registry_.use_default_usage = false;
+  }
+
+  /// Sets the default usage function.
+  void add_help ()
+  {
+    registry_.usage = nullptr;
+    registry_.use_default_usage = true;
+  }
+
+  /// Specify whether value type names should be printed in the default help
+  /// function.
+  void help_show_types (bool show)
+  {
+    registry_.help_show_types = show;
+    frozen_ = false;
+  }
+
+  /// Defines an alias.
+  void alias (std::string_view flag, std::string_view alias)
+  {
+    registry_.aliases[alias] = flag;
+    frozen_ = false;
+  }
+
+  /// Specify whether grouping multiple single-character boolean options into
+  /// one flag should be allowed.
+  void allow_grouping (bool allow = true)
+  { registry_.group_singles = allow; }
+
+  /// Specify whether flag parsing should stop at the first non-flag argument
+  /// (like with `POSIXLY_CORRECT` set for GNU getopt), all following
+  /// argv-elements are treated as non-flag arguments.
+  void stop_at_first_arg (bool stop = true)
+  { registry_.stop_at_args = stop; }
+
+  /// Specify whether flags may be abbreviated to any prefix that is unique
+  /// among all flags and aliases (like `--verb` for `--verbose`).  A prefix
+  /// of multiple names is an error reporting all of them, unless they are
+  /// aliases of the same flag.
+  void allow_abbreviations (bool allow = true)
+  {
+    registry_.abbreviations = allow;
+    frozen_ = false;
+  }
+
+  /// Specify whether an argument `@path` should be replaced by the arguments
+  /// in the file at `path` (like GCC and MSVC do), which are separated by
+  /// whitespace or null characters and may be quoted like in
+  /// `flag::tokenize`.  Files may include other files.
+  /// A file is mapped read-only, or read if it is not a regular file, and
+  /// released once its arguments are parsed.  The values of `const char *`
+  /// and `std::string_view` flags and the non-flag arguments taken from it
+  /// are therefore copies, which live until the set is destroyed or, if
+  /// `strings` is given, are allocated from it so the caller can release
+  /// them after each parse.  Callbacks and custom value types are not given
+  /// copies, their argument is only valid during the call.
+  /// Response files are not expanded by the `parse` overload permuting argv.
+  void allow_response_files (bool allow = true,
+                             std::pmr::memory_resource *strings = nullptr)
+  {
+    registry_.expand_response_files = allow;
+    registry_.response_strings.use (strings);
+  }
+
+  /// Enables shell completion: if the first argument is `__complete`,
+  /// `parse` prints the completions for the following words instead of
+  /// parsing them, `__completion bash|zsh|fish` prints the script for the
+  /// given shell that calls it.  Both exit the program.
+  void enable_completion (bool enable = true)
+  { registry_.completion = enable; }
+
+  /// Answers a completion request reported as `Process_Result::Complete` by a
+  /// non-exiting `parse`, see `enable_completion`.  Returns false if the
+  /// completion script for an unsupported shell was requested.
+  bool complete (int argc, const char *const *argv) const
+  {
+    freeze ();
+    return detail::complete (registry_, argc, argv);
+  }
+
+  /// Like the above but also completes the flags of `schema`.
+  template <class... Opts>
+  bool complete (int argc, const char *const *argv,
+                 const Schema<Opts...> &schema) const
+  {
+    freeze ();
+    return detail::complete (registry_, argc, argv, static_flags (schema));
+  }
+
+  /// Prints the usage for a `Process_Result::Help` reported by a non-exiting
+  /// `parse`, like `parse` does for `-help`: `pattern` is the `value` of the
+  /// error, which is only used by the default usage function.  Does nothing
+  /// if no usage function was added.
+  void print_usage (const char *program, std::string_view pattern = {}) const
+  {
+    freeze ();
+    detail::print_usage (registry_, program, pattern);
+  }
+
+  /// Like the above but also lists the flags of `schema`.
+  template <class... Opts>
+  void print_usage (const char *program, std::string_view pattern,
+                    const Schema<Opts...> &schema) const
+  {
+    freeze ();
+    detail::print_usage (registry_, program, pattern, static_flags (schema));
+  }
+
+  /// Sets how many similar flags are suggested for an unknown flag, at most
+  /// `detail::MAX_SUGGESTIONS`.  Passing 0 disables suggestions.
+  void max_suggestions (std::size_t count)
+  { registry_.suggestions = std::min (count, detail::MAX_SUGGESTIONS); }
+
+  /// Returns the names of the flags whose name, aliases or help text contain
+  /// `pattern` (ignoring ASCII case), best matches first, as listed by
+  /// `-help=PATTERN`.
+  std::vector<std::string_view> search (std::string_view pattern) const
+  {
+    freeze ();
+    const auto options = detail::search_help (
+      registry_, pattern, std::pmr::get_default_resource ());
+    std::vector<std::string_view> names;
+    names.reserve (options.size ());
+    for (const std::uint32_t i : options)
+      names.push_back (registry_.options.name (i));
+    return names;
+  }
+
+  /// Writes the names of up to `out.size ()` flags similar to `flag` to `out`,
+  /// most similar first, as suggested in the error for an unknown flag.
+  /// Returns the number of names written.
+  std::size_t suggest (std::string_view flag,
+                       std::span<std::string_view> out) const
+  {
+    freeze ();
+    return detail::find_similar (registry_, {}, flag, out);
+  }
+
+  /// Like the above but also suggests the flags of `schema`.
+  template <class... Opts>
+  std::size_t suggest (std::string_view flag, const Schema<Opts...> &schema,
+                       std::span<std::string_view> out) const
+  {
+    freeze ();
+    return detail::find_similar (registry_, static_flags (schema), flag, out);
+  }
+
+  /// Builds the lookup index over all flags and aliases.
+  /// This is done implicitly by `parse`, calling it explicitly moves the cost
+  /// to a point of the callers choosing.  Adding flags or aliases afterwards
+  /// is allowed but requires the index to be rebuilt, which must not happen
+  /// concurrently with parsing.
+  void freeze () const
+  {
+    if (frozen_.load (std::memory_order_acquire))
+      return;
+    std::lock_guard lock (freeze_mutex_);
+    if (frozen_.load (std::memory_order_relaxed))
+      return;
+    registry_.index.build (registry_.options, registry_.aliases);
+    registry_.singles.build (registry_.options, registry_.aliases,
+                             registry_.index);
+    registry_.lengths.build (registry_.options);
+    registry_.alias_names.build (registry_.options, registry_.aliases,
+                                 registry_.index);
+    {
+      std::lock_guard usage_lock (registry_.usage_mutex);
+      registry_.usage_text.clear ();
+      registry_.help_index.clear ();
+    }
+    if (registry_.abbreviations)
+      registry_.prefixes.build (registry_.options, registry_.aliases,
+                                registry_.index);
+    else
+      registry_.prefixes.clear ();
+    frozen_.store (true, std::memory_order_release);
+  }
+
+  bool frozen () const
+  { return frozen_.load (std::memory_order_acquire); }
+
+  /// Parses the flags in argv, calling `collect_arg` with each non-flag
+  /// argument.  This may be any callable taking a `const char *` (see
+  /// `Collect_Arg`) and optionally the index of the argument, it is called
+  /// directly rather than through a `std::function`.
+  template <class Collect>
+    requires detail::collector<Collect>
+  void parse (int argc, const char *const *argv, Collect &&collect_arg) const
+  {
+    exit_on_failure (argv, parse_with (argc, argv, collect_arg,
+                                       registry_process ()));
+  }
+
+  /// Parses flags from both a static schema and this set.
+  /// Flags are looked up in the schema first.
+  template <class... Opts, class Collect>
+    requires detail::collector<Collect>
+  void parse (int argc, const char *const *argv, Schema<Opts...> &schema,
+              Collect &&collect_arg) const
+  {
+    const auto flags = static_flags (schema);
+    exit_on_failure (argv, parse_with (argc, argv, collect_arg,
+                                       sink_process (schema), flags),
+                     flags);
+  }
+
+  /// Like `parse` but instead of printing a message and exiting on errors or
+  /// `-help` this returns where and why parsing stopped.  Arguments for which
+  /// the value type throws are reported as `Process_Result::Invalid_Value`.
+  template <class Collect>
+    requires detail::collector<Collect>
+  Parse_Result parse (int argc, const char *const *argv,
+                      Collect &&collect_arg, std::nothrow_t) const
+  {
+    return detail::to_result (parse_with (argc, argv, collect_arg,
+                                          registry_process ()));
+  }
+
+  template <class... Opts, class Collect>
+    requires detail::collector<Collect>
+  Parse_Result parse (int argc, const char *const *argv,
+                      Schema<Opts...> &schema, Collect &&collect_arg,
+                      std::nothrow_t) const
+  {
+    return detail::to_result (parse_with (argc, argv, collect_arg,
+                                          sink_process (schema),
+                                          static_flags (schema)));
+  }
 
-  // Trivial cases
-  if (a.empty () && b.empty ())
-    return 1.0;
-  else if (a.empty () || b.empty ())
-    return 0.0;
-  else if (a.size () == 1 && b.size () == 1)
-    return a[0] == b[0] ? 1.0 : 0.0;
+  /// Parses arguments given as string views, with `args[0]` being the
+  /// program name like `argv[0]`.  The arguments need not be null-terminated
+  /// so they may refer into a larger buffer, like a length-prefixed frame or
+  /// a mapped file.  Nothing is copied except the values of flags whose value
+  /// type or callback takes a `const char *`; `const char *` flags cannot be
+  /// set and report an invalid value.
+  /// `collect_arg` is called with each non-flag argument as a
+  /// `std::string_view` (and optionally its index).
+  template <class Collect>
+    requires detail::view_collector<Collect>
+  void parse (std::span<const std::string_view> args,
+              Collect &&collect_arg) const
+  {
+    exit_on_failure (args.data (),
+                     parse_with (static_cast<int> (args.size ()), args.data (),
+                                 collect_arg, registry_process ()));
+  }
 
-  // Distance a character can have from a position and still be considered matching.
-  const auto match_range = std::max (a.size (), b.size ()) / 2 - 1;
-  // Keeps tracl of characters in B we have already matched
-  auto used = std::vector (b.size (), false);
-  // Position of last character mached in B, used for order checking
-  auto b_pos = std::size_t {};
+  template <class... Opts, class Collect>
+    requires detail::view_collector<Collect>
+  void parse (std::span<const std::string_view> args, Schema<Opts...> &schema,
+              Collect &&collect_arg) const
+  {
+    const auto flags = static_flags (schema);
+    exit_on_failure (args.data (),
+                     parse_with (static_cast<int> (args.size ()), args.data (),
+                                 collect_arg, sink_process (schema), flags),
+                     flags);
+  }
 
-  auto matches = 0.0;
-  auto transpositions = 0.0;
+  template <class Collect>
+    requires detail::view_collector<Collect>
+  Parse_Result parse (std::span<const std::string_view> args,
+                      Collect &&collect_arg, std::nothrow_t) const
+  {
+    return detail::to_result (parse_with (static_cast<int> (args.size ()),
+                                          args.data (), collect_arg,
+                                          registry_process ()));
+  }
 
-  for (std::size_t i = 0; i < a.size (); ++i)
-    {
-      const auto c = a[i];
-      const auto lo = i > match_range ? i - match_range : 0;
-      const auto hi = std::min (i + match_range, b.size () - 1);
-      for (std::size_t j = lo; j <= hi; ++j)
-        {
-          const auto d = b[j];
-          if (c == d && !used[j])
-            {
-              used[j] = true;
-              ++matches;
-              if (j < b_pos)
-                ++transpositions;
-              b_pos = j;
-              break;
-            }
-        }
-    }
+  template <class... Opts, class Collect>
+    requires detail::view_collector<Collect>
+  Parse_Result parse (std::span<const std::string_view> args,
+                      Schema<Opts...> &schema, Collect &&collect_arg,
+                      std::nothrow_t) const
+  {
+    return detail::to_result (parse_with (static_cast<int> (args.size ()),
+                                          args.data (), collect_arg,
+                                          sink_process (schema),
+                                          static_flags (schema)));
+  }
 
-  if (matches == 0.0)
-    return 0.0;
-  else
-    return 0.333 * ((matches / a.size ())
-                    + (matches / b.size ())
-                    + ((matches - transpositions) / matches));
-}
+  /// Returns the non-flag arguments, which refer into the given views.
+  std::vector<std::string_view>
+  parse (std::span<const std::string_view> args) const
+  {
+    std::vector<std::string_view> rest;
+    rest.reserve (args.empty () ? 0 : args.size () - 1);
+    parse (args, [&rest] (std::string_view arg) { rest.push_back (arg); });
+    return rest;
+  }
 
-// https://en.wikipedia.org/wiki/Jaro%E2%80%93Winkler_distance#Jaro%E2%80%93Winkler_similarity
-static inline double
-jaro_winkler_similarity (std::string_view a, std::string_view b)
-{
-  constexpr double SCALING_FACTOR = 0.1;
-  const auto sim_j = jaro_similarity (a, b);
-  const auto l = std::distance (
-    a.begin (),
-    std::mismatch (a.begin (), a.end (), b.begin (), b.end ()).first
-  );
-  const auto sim_w = sim_j - l * SCALING_FACTOR * (1.0 - sim_j);
-  return sim_w <= 1.0 ? sim_w : 1.0;
-}
+  template <class T, class Allocator>
+  void parse (int argc, const char *const *argv,
+              std::vector<T, Allocator> &args) const
+  {
+    // There can't be more arguments than argv-elements.
+    args.reserve (args.size () + std::max (argc - 1, 0));
+    const auto add = [&args] (const char *arg) { args.emplace_back (arg); };
+    if constexpr (std::is_pointer_v<T> || std::is_same_v<T, std::string_view>)
+      parse (argc, argv, add);
+    else
+      parse (argc, argv, detail::Copying_Collector<decltype (add)> {add});
+  }
 
-static inline void
-look_for_similar (std::string_view dash, std::string_view flag)
-{
-  constexpr double THRESHHOLD = 0.8;
-  std::string_view best_match = {};
-  double most_similar = 0.0;
-  for (const auto &option : options)
-    {
-      const auto opt = option->flag ();
-      const auto sim = jaro_winkler_similarity (opt, flag);
-      if (sim > THRESHHOLD && sim > most_similar)
-        {
-          best_match = opt;
-          most_similar = sim;
-        }
-    }
-  if (not best_match.empty ())
-    std::cerr << ", did you mean " << dash << best_match << "?";
-}
+  template <class T = const char *>
+  std::vector<T> parse (int argc, const char *const *argv) const
+  {
+    std::vector<T> args;
+    parse (argc, argv, args);
+    return args;
+  }
 
-static inline void
-complain (const char *program, Process_Result about, std::string_view flag,
-          std::string_view value, bool double_dash)
-{
-  std::cerr << program << ": ";
-  // Since we extract the flag name from the arg-element we need to add the
-  // correct number of dashes to the error message
-  std::string_view dash = double_dash ? "--" : "-";
-  switch (about)
-    {
-      break; case Process_Result::Ok: // To suppress warnings
-      break; case Process_Result::Invalid_Option:
-        std::cerr << "unrecognized option ‘" << dash << flag << "’";
-        look_for_similar (dash, flag);
-      break; case Process_Result::Missing_Value:
-        std::cerr << "option ‘" << dash << flag <<  "’ requires an argument";
-      break; case Process_Result::Unexpected_Value:
-        std::cerr << "option ‘" << dash << flag
-                  << "’ doesn't allow an argument";
-      break; case Process_Result::Invalid_Value:
-        std::cerr << "invalid argument ‘" << value <<  "’ for ‘" << dash
-                  << flag << "’";
-    }
-  std::cerr << std::endl;
-  if (!error_description.empty ())
-    std::cerr << error_description << std::endl;
-}
+  /// Returns the arguments in a vector using the given memory resource.
+  template <class T = const char *>
+  std::pmr::vector<T> parse (int argc, const char *const *argv,
+                             std::pmr::memory_resource *resource) const
+  {
+    std::pmr::vector<T> args (resource);
+    parse (argc, argv, args);
+    return args;
+  }
 
-/// Calls the given function with each codepoint of the given string in utf-8.
-/// As soon the function does not return `Process_Result::Ok` that return value
-/// is returned, if the function is ok for each codepoint `Process_Result::Ok`
-/// is returned.
-///
-/// The signature of the given function must be:
-/// ```
-/// Process_Result f(std::string_view codepoint, bool is_last);
-/// ```
-template<class F>
-requires std::is_invocable_r_v<Process_Result, F, std::string_view, bool>
-static Process_Result
-iter_codepoints(std::string_view s, F f)
+  /// Parses without copying the non-flag arguments: like GNU getopt argv is
+  /// permuted in place so that the non-flag arguments follow `argv[0]` in
+  /// their original order, the returned span refers to them.  The flags are
+  /// moved after them in an unspecified order.
+  /// If flag parsing stops early (at `--` or the first non-flag argument
+  /// with `stop_at_first_arg`) and no non-flag arguments were seen before
+  /// that, the remaining argv-elements are returned as they are without
+  /// being looked at.
+  std::span<const char *const> parse (int argc, const char **argv,
+                                      Permute) const
+  {
+    freeze ();
+    int end = 1;
+    const auto failure = detail::parse_args<false> (
+      registry_, argc, argv, [argv, &end] (const char *, int i) {
+        // Everything before `i` has been processed, so this only moves
+        // already processed flags.
+        std::swap (argv[end++], argv[i]);
+      }, registry_process ());
+    exit_on_failure (argv, failure);
+    // Without even a program name `rest` is past the end.
+    int rest = std::min (failure.rest, argc);
+    if (end == 1)
+      return {argv + rest, static_cast<std::size_t> (argc - rest)};
+    for (; rest < argc; ++rest)
+      std::swap (argv[end++], argv[rest]);
+    return {argv + 1, static_cast<std::size_t> (end - 1)};
+  }
+
+  std::span<const char *const> parse (int argc, char **argv,
+                                      Permute permute) const
+  {
+    // `char *` and `const char *` may alias.
+    return parse (argc, const_cast<const char **> (argv), permute);
+  }
+
+  /// Parses a command line given as a null-separated buffer in place: the
+  /// arguments are found with `memchr` and passed on as views into the
+  /// buffer, nothing is copied.
+  template <class Collect>
+    requires detail::view_collector<Collect>
+  void parse (Null_Separated command_line, Collect &&collect_arg) const
+  {
+    const detail::Split_Command_Line split (command_line.buffer);
+    exit_on_failure (split.argv (), parse_with (split.argc (), split.argv (),
+                                                collect_arg,
+                                                registry_process ()));
+  }
+
+  template <class Collect>
+    requires detail::view_collector<Collect>
+  Parse_Result parse (Null_Separated command_line, Collect &&collect_arg,
+                      std::nothrow_t) const
+  {
+    const detail::Split_Command_Line split (command_line.buffer);
+    return detail::to_result (parse_with (split.argc (), split.argv (),
+                                          collect_arg, registry_process ()));
+  }
+
+  /// Parses one command line into the given sink without printing anything
+  /// or exiting, see `flag::parse_batch`.
+  template <class Sink>
+  Parse_Result parse_into (int argc, const char *const *argv,
+                           Sink &sink) const
+  {
+    return detail::to_result (parse_with (argc, argv, sink_collect (sink),
+                                          sink_process (sink),
+                                          static_flags (sink)));
+  }
+
+  template <class Sink>
+    requires detail::view_sink<Sink>
+  Parse_Result parse_into (Null_Separated command_line, Sink &sink) const
+  {
+    const detail::Split_Command_Line split (command_line.buffer);
+    return detail::to_result (parse_with (split.argc (), split.argv (),
+                                          sink_collect (sink),
+                                          sink_process (sink),
+                                          static_flags (sink)));
+  }
+};
+
+/// An argument vector as given to `main`.
+struct Command_Line
 {
-  std::size_t begin = 0;
-  for (std::size_t i = 1; i < s.size(); ++i)
-    {
-      if ((s[i] & 0xC0) != 0x80)
-        {
-          if (const auto r = f(s.substr(begin, i - begin), false);
-              r != Process_Result::Ok)
-            return r;
-          begin = i;
-        }
-    }
-  return f(s.substr(begin), true);
-}
+  int argc;
+  const char *const *argv;
+};
 
-/// Checks if the given flag is valid inside a group.
-/// The length of the flag is not checked.
-static Process_Result
-is_valid_single(std::string_view flag, bool is_last)
+/// A `Schema` that also collects the non-flag arguments, the default sink for
+/// `flag::parse_batch`.  The arguments refer into the parsed command line.
+template <class... Opts>
+struct Batch_Sink : Schema<Opts...>
 {
-  const auto opt = find_option(flag);
-  // Only the last option in a group may take a value
-  const auto is_ok = opt != nullptr && (!opt->takes_value() || is_last);
-  // The false value doesn't matter here as long as it's not `Ok`
-  return is_ok ? Process_Result::Ok : Process_Result::Invalid_Option;
-}
+  std::vector<std::string_view> args = {};
 
-/// Checks if the given full flag is a valid group of single-character flags.
-static inline bool
-is_valid_group(std::string_view flag)
+  void collect_arg (std::string_view arg)
+  { args.emplace_back (arg); }
+};
+
+/// Parses many command lines against the same frozen flag set, spread over
+/// `threads` threads (the hardware concurrency if 0).
+///
+/// `command_lines[i]` is parsed into `sinks[i]` and its result is stored in
+/// `results[i]`; nothing is printed and the program does not exit on errors
+/// or `-help`.  A sink has the `process_flag` function of a `Schema` and a
+/// `collect_arg` function taking a `std::string_view` or a `const char *`,
+/// flags not handled by the sink are looked up in `set`, so those must be
+/// safe to set concurrently.
+template <class Sink>
+static inline void
+parse_batch (const Flag_Set &set, std::span<const Command_Line> command_lines,
+             std::span<Sink> sinks, std::span<Process_Result> results,
+             unsigned threads = 0)
 {
-  return iter_codepoints(flag, is_valid_single) == Process_Result::Ok;
+  if (sinks.size () < command_lines.size ()
+      || results.size () < command_lines.size ())
+    throw std::invalid_argument ("Not enough sinks or results");
+  set.freeze ();
+  detail::run_batch (command_lines.size (), threads, [&] (std::size_t i) {
+    results[i] = set.parse_into (command_lines[i].argc, command_lines[i].argv,
+                                 sinks[i]).error ().result;
+  });
 }
 
-/// Processes a single-character flag group.
-/// Returns the last flag and the result of settings its value.
-static std::pair<std::string_view, Process_Result>
-process_group(std::string_view flags, std::string_view value, int &argind,
-              int argc, const char *const *argv)
+/// Like the above for null-separated command lines such as the contents of
+/// `/proc/PID/cmdline`, which are split in place.  The sink's `collect_arg`
+/// has to take a `std::string_view`.
+template <class Sink>
+  requires detail::view_sink<Sink>
+static inline void
+parse_batch (const Flag_Set &set, std::span<const Null_Separated> command_lines,
+             std::span<Sink> sinks, std::span<Process_Result> results,
+             unsigned threads = 0)
 {
-  using namespace std::literals;
-  int dummy_argind = 0;
-  std::string_view dummy_value = ""sv;
-  std::string_view last_flag = ""sv;
-  const auto result = iter_codepoints(flags, [&](std::string_view flag, bool is_last) {
-    if (is_last)
-      {
-        last_flag = flag;
-        return process_flag(flag, value, argind, argc, argv);
-      }
-    else
-      // We already checked these don't take a value so the dummy values and
-      // `nullptr` are safe here.
-      return process_flag(flag, dummy_value, dummy_argind, 0, nullptr);
+  if (sinks.size () < command_lines.size ()
+      || results.size () < command_lines.size ())
+    throw std::invalid_argument ("Not enough sinks or results");
+  set.freeze ();
+  detail::run_batch (command_lines.size (), threads, [&] (std::size_t i) {
+    results[i] = set.parse_into (command_lines[i], sinks[i]).error ().result;
   });
-  return std::make_pair(last_flag, result);
 }
 
-} // namespace detail
+/// The flag set used by the free functions.
+inline Flag_Set &
+default_set ()
+{
+  static Flag_Set set;
+  return set;
+}
 
 template <class T>
+  requires (!detail::callback<T>)
 static inline void
 add (T &value, std::string_view flag, std::string_view help_text = "")
 {
-  using namespace std::literals;
-  static_assert (types::Value_Type<T>::is_supported, "Unsupported type");
-  if (flag.empty ())
-    throw std::invalid_argument ("Empty flag");
-  auto *opt = new detail::Option_Type<T> (&value, flag, help_text);
-  detail::options.emplace_back (opt);
+  default_set ().add (value, flag, help_text);
 }
 
+template <class F>
+  requires detail::callback<F>
 static inline void
-add (Option_Callable func, std::string_view flag, std::string_view help_text = "")
+add (F &&func, std::string_view flag, std::string_view help_text = "")
 {
-  if (flag.empty ())
-    throw std::invalid_argument ("Empty flag");
-  auto *opt = new detail::Option_Type<Option_Callable> (func, flag, help_text);
-  detail::options.emplace_back (opt);
+  default_set ().add (std::forward<F> (func), flag, help_text);
 }
 
 /// Sets a custom usage function.
+template <class F>
+  requires std::is_invocable_v<F &, const char *>
 static inline void
-add_help (Help_Function usage)
+add_help (F &&usage)
 {
-  detail::usage = usage;
+  default_set ().add_help (std::forward<F> (usage));
 }
 
 /// Sets the default usage function.
 static inline void
 add_help ()
 {
-  add_help (detail::default_usage);
+  default_set ().add_help ();
 }
 
 /// Specify whether value type names should be printed in the default help
@@ -554,14 +4386,14 @@ add_help ()
 static inline void
 help_show_types (bool show)
 {
-  detail::help_show_types = show;
+  default_set ().help_show_types (show);
 }
 
 /// Defines an alias.
 static inline void
 alias (std::string_view flag, std::string_view alias)
 {
-  detail::aliases[alias] = flag;
+  default_set ().alias (flag, alias);
 }
 
 /// Specify whether grouping multiple single-character boolean options into
@@ -571,99 +4403,185 @@ alias (std::string_view flag, std::string_view alias)
 static inline void
 allow_grouping(bool allow = true)
 {
-  detail::group_singles = allow;
+  default_set ().allow_grouping (allow);
 }
 
+/// Specify whether flag parsing should stop at the first non-flag argument.
+/// By default flags and non-flag arguments may be mixed.
 static inline void
-parse (int argc, const char *const *argv, Collect_Arg collect_arg)
+stop_at_first_arg (bool stop = true)
 {
-  using namespace std::literals;
-  using namespace detail;
+  default_set ().stop_at_first_arg (stop);
+}
 
-  const bool has_usage = bool (usage);
+/// Specify whether flags may be abbreviated to a unique prefix.
+static inline void
+allow_abbreviations (bool allow = true)
+{
+  default_set ().allow_abbreviations (allow);
+}
 
-#if defined (_WIN32) && defined (FLAG_SHORTEN_WINDOWS_PROGRAM_PATH)
-  // Powershell always gives the full path of the executable so
-  // we use this option to allow for it to be shortened to just the
-  // name of the executable (still including the .exe)
-  const auto program = std::filesystem::path (argv[0]).filename ().string ();
-  const char *const argv0 = program.c_str ();
-#else
-  const char *const argv0 = argv[0];
-#endif
+/// Specify whether `@path` arguments are replaced by the arguments in the
+/// file, see `Flag_Set::allow_response_files`.
+static inline void
+allow_response_files (bool allow = true,
+                      std::pmr::memory_resource *strings = nullptr)
+{
+  default_set ().allow_response_files (allow, strings);
+}
 
-  int i;
-  for (i = 1; i < argc; ++i)
-    {
-      if (argv[i][0] == '-')
-        {
-          const std::string_view arg = argv[i] + 1 + (argv[i][1] == '-');
-          if (arg.empty ())
-            {
-              ++i;
-              break;
-            }
-          if (has_usage && arg == "help")
-            {
-              usage (argv0);
-              std::exit (0);
-            }
-          const std::size_t eq_pos = arg.find ('=');
-          const std::string_view flag = arg.substr (0, eq_pos);
-          // If this is empty now it will recieve the value of the following
-          // argv-element in `detail::process_flag`.
-          std::string_view value = (eq_pos == std::string_view::npos
-                                    ? ""sv
-                                    : arg.substr (eq_pos + 1));
-          const auto result = process_flag (flag, value, i, argc, argv);
-          if (result != Process_Result::Ok
-              && group_singles
-              && is_valid_group(flag))
-            {
-              const auto [f, r] = process_group(flag, value, i, argc, argv);
-              if (r == Process_Result::Ok)
-                continue;
-              // Last flag in the group had an error with its value,
-              // in this case we just print the error messages for both
-              // this flag and the original flag.
-              complain (argv0, r, f, value, (argv[i][1] == '-'));
-            }
-          if (result != Process_Result::Ok)
-            {
-              complain (argv0, result, flag, value, (argv[i][1] == '-'));
-              if (has_usage)
-                std::cerr << "Try '" << argv0
-                          << " -help' for more information.\n";
-              std::exit (1);
-            }
-        }
-      else
-        collect_arg (argv[i]);
-    }
+/// Enables shell completion, see `Flag_Set::enable_completion`.
+static inline void
+enable_completion (bool enable = true)
+{
+  default_set ().enable_completion (enable);
+}
 
-  // Collect remaining arguments if we broke out of the above loop
-  for (; i < argc; ++i)
-    collect_arg (argv[i]);
+/// Sets how many similar flags are suggested for an unknown flag.
+static inline void
+max_suggestions (std::size_t count)
+{
+  default_set ().max_suggestions (count);
 }
 
-template <class T>
+/// Builds the lookup index of the default flag set, see `Flag_Set::freeze`.
 static inline void
-parse (int argc, const char *const *argv, std::vector<T> &args)
+freeze ()
 {
-  parse (argc, argv, [&args] (const char *arg) {
-    args.emplace_back (arg);
-  });
+  default_set ().freeze ();
+}
+
+template <class Collect>
+  requires detail::collector<Collect>
+static inline void
+parse (int argc, const char *const *argv, Collect &&collect_arg)
+{
+  default_set ().parse (argc, argv, collect_arg);
+}
+
+/// Parses flags from both a static schema and the runtime registry.
+/// Flags are looked up in the schema first.
+template <class... Opts, class Collect>
+  requires detail::collector<Collect>
+static inline void
+parse (int argc, const char *const *argv, Schema<Opts...> &schema,
+       Collect &&collect_arg)
+{
+  default_set ().parse (argc, argv, schema, collect_arg);
+}
+
+/// Parses without exiting, see `Flag_Set::parse (..., std::nothrow_t)`.
+template <class Collect>
+  requires detail::collector<Collect>
+static inline Parse_Result
+parse (int argc, const char *const *argv, Collect &&collect_arg,
+       std::nothrow_t)
+{
+  return default_set ().parse (argc, argv, collect_arg, std::nothrow);
+}
+
+template <class... Opts, class Collect>
+  requires detail::collector<Collect>
+static inline Parse_Result
+parse (int argc, const char *const *argv, Schema<Opts...> &schema,
+       Collect &&collect_arg, std::nothrow_t)
+{
+  return default_set ().parse (argc, argv, schema, collect_arg, std::nothrow);
+}
+
+/// Parses by permuting argv, see `Flag_Set::parse (..., Permute)`.
+static inline std::span<const char *const>
+parse (int argc, const char **argv, Permute permute)
+{
+  return default_set ().parse (argc, argv, permute);
+}
+
+static inline std::span<const char *const>
+parse (int argc, char **argv, Permute permute)
+{
+  return default_set ().parse (argc, argv, permute);
+}
+
+/// Parses arguments given as string views, see
+/// `Flag_Set::parse (std::span<const std::string_view>, ...)`.
+template <class Collect>
+  requires detail::view_collector<Collect>
+static inline void
+parse (std::span<const std::string_view> args, Collect &&collect_arg)
+{
+  default_set ().parse (args, collect_arg);
+}
+
+template <class... Opts, class Collect>
+  requires detail::view_collector<Collect>
+static inline void
+parse (std::span<const std::string_view> args, Schema<Opts...> &schema,
+       Collect &&collect_arg)
+{
+  default_set ().parse (args, schema, collect_arg);
+}
+
+template <class Collect>
+  requires detail::view_collector<Collect>
+static inline Parse_Result
+parse (std::span<const std::string_view> args, Collect &&collect_arg,
+       std::nothrow_t)
+{
+  return default_set ().parse (args, collect_arg, std::nothrow);
+}
+
+template <class... Opts, class Collect>
+  requires detail::view_collector<Collect>
+static inline Parse_Result
+parse (std::span<const std::string_view> args, Schema<Opts...> &schema,
+       Collect &&collect_arg, std::nothrow_t)
+{
+  return default_set ().parse (args, schema, collect_arg, std::nothrow);
+}
+
+static inline std::vector<std::string_view>
+parse (std::span<const std::string_view> args)
+{
+  return default_set ().parse (args);
+}
+
+/// Parses a null-separated command line in place, see
+/// `Flag_Set::parse (Null_Separated, ...)`.
+template <class Collect>
+  requires detail::view_collector<Collect>
+static inline void
+parse (Null_Separated command_line, Collect &&collect_arg)
+{
+  default_set ().parse (command_line, collect_arg);
+}
+
+template <class Collect>
+  requires detail::view_collector<Collect>
+static inline Parse_Result
+parse (Null_Separated command_line, Collect &&collect_arg, std::nothrow_t)
+{
+  return default_set ().parse (command_line, collect_arg, std::nothrow);
+}
+
+template <class T, class Allocator>
+static inline void
+parse (int argc, const char *const *argv, std::vector<T, Allocator> &args)
+{
+  default_set ().parse (argc, argv, args);
 }
 
 template <class T = const char *>
 static inline std::vector<T>
 parse (int argc, const char *const *argv)
 {
-  std::vector<T> args;
-  parse (argc, argv, [&args] (const char *arg) {
-    args.emplace_back (arg);
-  });
-  return args;
+  return default_set ().parse<T> (argc, argv);
+}
+
+template <class T = const char *>
+static inline std::pmr::vector<T>
+parse (int argc, const char *const *argv, std::pmr::memory_resource *resource)
+{
+  return default_set ().parse<T> (argc, argv, resource);
 }
 
 static inline void
@@ -672,4 +4590,63 @@ set_description (std::string_view description)
   detail::error_description = description;
 }
 
+/// Returns the Jaro-Winkler similarity of two strings, between 0 and 1.  This
+/// is the measure used to suggest flags for unknown ones, only the first
+/// `detail::MAX_SIMILARITY_LENGTH` bytes of each string are compared.
+static inline double
+similarity (std::string_view a, std::string_view b)
+{
+  return detail::jaro_winkler_similarity (a, b);
+}
+
+/// Splits a command string into arguments following the quoting rules of a
+/// POSIX shell: arguments are separated by unquoted blanks (space, tab or
+/// newline), a backslash quotes the next character (a backslash-newline is
+/// removed), single quotes quote everything up to the next single quote and
+/// within double quotes a backslash only quotes `$`, `` ` ``, `"`, `\` or a
+/// newline.  Nothing is expanded, so `$`, `*` or `~` are taken literally.
+///
+/// The unquoted arguments are written to `buffer`, each followed by a null
+/// character (except the last one if the buffer is full), and returned as a
+/// `Null_Separated` command line referring into it which can be passed to
+/// `parse` directly.  The first argument is the program name.
+/// Unquoting never makes the text longer so the buffer needs to be only as
+/// large as `command`, and it may be the memory of `command` itself.
+/// Throws `std::invalid_argument` if a quote is not closed or the buffer is
+/// too small.
+static inline Null_Separated
+tokenize (std::string_view command, std::span<char> buffer)
+{
+  if (buffer.size () < command.size ())
+    throw std::invalid_argument ("Buffer too small");
+  const char *in = command.data ();
+  const char *const end = in + command.size ();
+  char *const first = buffer.data ();
+  char *out = first;
+  for (;;)
+    {
+      in = detail::skip_blanks<false> (in, end);
+      if (in == end)
+        break;
+      // `in` is always at or after `out`.
+      if (!detail::unquote_argument<false> (in, end, out))
+        throw std::invalid_argument ("Unterminated quote");
+      // Step over the blank first, the separator may overwrite it.  It may
+      // only be missing after the last argument, which is not empty then
+      // since an empty argument is written from at least two quotes.
+      if (in != end)
+        ++in;
+      if (out != first + buffer.size ())
+        *out++ = '\0';
+    }
+  return {{first, static_cast<std::size_t> (out - first)}};
+}
+
+/// Tokenizes `command` in place, see above.
+static inline Null_Separated
+tokenize (std::span<char> command)
+{
+  return tokenize ({command.data (), command.size ()}, command);
+}
+
 }